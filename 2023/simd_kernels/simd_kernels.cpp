@@ -0,0 +1,368 @@
+// simd_kernels.cpp
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+
+namespace simd {
+
+enum class Isa { Scalar, Sse42, Avx2, Avx512 };
+
+std::string_view name(Isa isa) {
+  constexpr std::array names{"scalar", "SSE4.2", "AVX2", "AVX-512"};
+  return names[static_cast<int>(isa)];
+}
+
+// Best instruction set of this CPU, checked once
+Isa detectedIsa() {
+  static const Isa isa = [] {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    // every feature in the target attributes of the AVX-512 kernels
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl") &&
+        __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vbmi2")) {
+      return Isa::Avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+    if (__builtin_cpu_supports("sse4.2")) return Isa::Sse42;
+#endif
+    return Isa::Scalar;
+  }();
+  return isa;
+}
+
+struct CharRange {
+  unsigned char first;
+  unsigned char last;
+};
+
+// ASCII character class as a union of byte ranges; matches like
+// std::isupper and friends in the "C" locale
+template <CharRange... Ranges>
+struct CharClass {
+  constexpr bool operator()(char c) const {
+    const auto u = static_cast<unsigned char>(c);
+    return ((static_cast<unsigned char>(u - Ranges.first) <=
+             Ranges.last - Ranges.first) ||
+            ...);
+  }
+};
+
+inline constexpr CharClass<CharRange{'A', 'Z'}> is_upper;
+inline constexpr CharClass<CharRange{'a', 'z'}> is_lower;
+inline constexpr CharClass<CharRange{'0', '9'}> is_digit;
+inline constexpr CharClass<CharRange{'\t', '\r'}, CharRange{' ', ' '}>
+    is_space;
+
+namespace detail {
+
+#ifdef SIMD_X86
+
+// Byte b of entry m is the index of the b-th set bit of m; unused bytes
+// are 0x80, which makes pshufb write zero
+constexpr auto compactTable = [] {
+  std::array<std::uint64_t, 256> table{};
+  for (unsigned mask = 0; mask < 256; ++mask) {
+    std::uint64_t entry = 0x8080808080808080ULL;
+    unsigned pos = 0;
+    for (unsigned bit = 0; bit < 8; ++bit) {
+      if (mask & (1u << bit)) {
+        entry &= ~(0xffULL << (8 * pos));
+        entry |= std::uint64_t{bit} << (8 * pos);
+        ++pos;
+      }
+    }
+    table[mask] = entry;
+  }
+  return table;
+}();
+
+// Writes the bytes of v selected by keep to out, returns the new end.
+// Each half is stored with 8 bytes, so up to 16 bytes past out are
+// overwritten, which is fine as long as out trails the input.
+__attribute__((target("sse4.2"))) inline char* compact16(__m128i v,
+                                                         unsigned keep,
+                                                         char* out) {
+  const auto low = keep & 0xff;
+  const auto high = keep >> 8;
+  const auto control =
+      _mm_set_epi64x(compactTable[high] + 0x0808080808080808ULL,
+                     compactTable[low]);
+  const auto packed = _mm_shuffle_epi8(v, control);
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), packed);
+  out += std::popcount(low);
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out),
+                   _mm_unpackhi_epi64(packed, packed));
+  return out + std::popcount(high);
+}
+
+// Bytes in [range.first, range.last] as 0xff: after subtracting first
+// the unsigned minimum with the width is x itself only inside the range
+__attribute__((target("sse4.2"))) inline __m128i inRangeSse42(
+    __m128i v, CharRange range) {
+  const auto x = _mm_sub_epi8(v, _mm_set1_epi8(range.first));
+  const auto width = _mm_set1_epi8(range.last - range.first);
+  return _mm_cmpeq_epi8(_mm_min_epu8(x, width), x);
+}
+
+template <CharRange... Ranges>
+__attribute__((target("sse4.2"))) inline unsigned matchSse42(
+    __m128i v, CharClass<Ranges...>) {
+  __m128i match = _mm_setzero_si128();
+  (..., (match = _mm_or_si128(match, inRangeSse42(v, Ranges))));
+  return static_cast<unsigned>(_mm_movemask_epi8(match));
+}
+
+__attribute__((target("avx2"))) inline __m256i inRangeAvx2(__m256i v,
+                                                           CharRange range) {
+  const auto x = _mm256_sub_epi8(v, _mm256_set1_epi8(range.first));
+  const auto width = _mm256_set1_epi8(range.last - range.first);
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(x, width), x);
+}
+
+template <CharRange... Ranges>
+__attribute__((target("avx2"))) inline unsigned matchAvx2(
+    __m256i v, CharClass<Ranges...>) {
+  __m256i match = _mm256_setzero_si256();
+  (..., (match = _mm256_or_si256(match, inRangeAvx2(v, Ranges))));
+  return static_cast<unsigned>(_mm256_movemask_epi8(match));
+}
+
+template <CharRange... Ranges>
+__attribute__((target("avx512bw"))) inline __mmask64 matchAvx512(
+    __m512i v, CharClass<Ranges...>) {
+  __mmask64 match = 0;
+  (..., (match |= _mm512_cmple_epu8_mask(
+             _mm512_sub_epi8(v, _mm512_set1_epi8(Ranges.first)),
+             _mm512_set1_epi8(Ranges.last - Ranges.first))));
+  return match;
+}
+
+template <typename Pred>
+__attribute__((target("sse4.2"))) char* eraseSse42(char* first, char* last,
+                                                   Pred pred) {
+  char* out = first;
+  for (; last - first >= 16; first += 16) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+    out = compact16(v, ~matchSse42(v, pred) & 0xffff, out);
+  }
+  return std::remove_copy_if(first, last, out, pred);
+}
+
+template <typename Pred>
+__attribute__((target("avx2"))) char* eraseAvx2(char* first, char* last,
+                                                Pred pred) {
+  char* out = first;
+  for (; last - first >= 32; first += 32) {
+    const auto v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+    const auto keep = ~matchAvx2(v, pred);
+    out = compact16(_mm256_castsi256_si128(v), keep & 0xffff, out);
+    out = compact16(_mm256_extracti128_si256(v, 1), keep >> 16, out);
+  }
+  return std::remove_copy_if(first, last, out, pred);
+}
+
+// vpcompressb packs the kept bytes in one instruction
+template <typename Pred>
+__attribute__((target("avx512bw,avx512vbmi2"))) char* eraseAvx512(
+    char* first, char* last, Pred pred) {
+  char* out = first;
+  for (; last - first >= 64; first += 64) {
+    const auto v = _mm512_loadu_si512(first);
+    const auto keep = ~matchAvx512(v, pred);
+    _mm512_storeu_si512(out, _mm512_maskz_compress_epi8(keep, v));
+    out += std::popcount(keep);
+  }
+  return std::remove_copy_if(first, last, out, pred);
+}
+
+// The loop is written once and inlined into a clone per instruction set,
+// where the compiler vectorises it for that target
+template <typename T, typename Op>
+__attribute__((always_inline)) inline void transformLoop(const T* in, T* out,
+                                                         std::size_t size,
+                                                         Op& op) {
+  for (std::size_t i = 0; i < size; ++i) out[i] = op(in[i]);
+}
+
+template <typename T, typename Op>
+__attribute__((target("sse4.2"))) void transformSse42(const T* in, T* out,
+                                                      std::size_t size,
+                                                      Op& op) {
+  transformLoop(in, out, size, op);
+}
+
+template <typename T, typename Op>
+__attribute__((target("avx2"))) void transformAvx2(const T* in, T* out,
+                                                   std::size_t size, Op& op) {
+  transformLoop(in, out, size, op);
+}
+
+template <typename T, typename Op>
+__attribute__((target("avx512f,avx512bw,avx512vl,avx512dq"))) void
+transformAvx512(const T* in, T* out, std::size_t size, Op& op) {
+  transformLoop(in, out, size, op);
+}
+
+#endif
+
+}  // namespace detail
+
+// Removes the characters of the class and returns the kept prefix
+template <CharRange... Ranges>
+std::span<char> erase_if(std::span<char> text, CharClass<Ranges...> pred,
+                         Isa isa = detectedIsa()) {
+  auto first = text.data();
+  auto last = first + text.size();
+  char* end = nullptr;
+  switch (isa) {
+#ifdef SIMD_X86
+    case Isa::Avx512:
+      end = detail::eraseAvx512(first, last, pred);
+      break;
+    case Isa::Avx2:
+      end = detail::eraseAvx2(first, last, pred);
+      break;
+    case Isa::Sse42:
+      end = detail::eraseSse42(first, last, pred);
+      break;
+#endif
+    default:
+      end = std::remove_if(first, last, pred);
+  }
+  return text.first(static_cast<std::size_t>(end - first));
+}
+
+// Like std::erase_if: returns the number of erased characters
+template <CharRange... Ranges>
+std::size_t erase_if(std::string& str, CharClass<Ranges...> pred,
+                     Isa isa = detectedIsa()) {
+  const auto kept = erase_if(std::span<char>{str}, pred, isa).size();
+  const auto erased = str.size() - kept;
+  str.resize(kept);
+  return erased;
+}
+
+// out[i] = op(in[i]); in and out may be the same span
+template <typename T, typename Op>
+void transform(std::span<const T> in, std::span<T> out, Op op,
+               Isa isa = detectedIsa()) {
+  const auto size = std::min(in.size(), out.size());
+  switch (isa) {
+#ifdef SIMD_X86
+    case Isa::Avx512:
+      detail::transformAvx512(in.data(), out.data(), size, op);
+      break;
+    case Isa::Avx2:
+      detail::transformAvx2(in.data(), out.data(), size, op);
+      break;
+    case Isa::Sse42:
+      detail::transformSse42(in.data(), out.data(), size, op);
+      break;
+#endif
+    default:
+      for (std::size_t i = 0; i < size; ++i) out[i] = op(in[i]);
+  }
+}
+
+template <typename T, typename Op>
+void transform(std::span<T> inOut, Op op, Isa isa = detectedIsa()) {
+  transform(std::span<const T>{inOut}, inOut, op, isa);
+}
+
+}  // namespace simd
+
+template <typename Func>
+void getThroughput(const std::string& title, std::size_t bytes, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec. ("
+            << bytes / dur.count() / 1e9 << " GB/s)\n";
+}
+
+int main() {
+  std::string str{"Only For TesTing PurPose."};
+  std::cout << "str: " << str << '\n';
+
+  simd::erase_if(str, simd::is_upper);
+  std::cout << "str: " << str << '\n';
+
+  std::vector vec{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  std::span span1(vec);
+  simd::transform(span1.subspan(1, span1.size() - 2),
+                  [](int i) { return i * i; });
+  for (auto e : vec) std::cout << e << ' ';
+  std::cout << "\n\n";
+
+  const auto best = simd::detectedIsa();
+  std::vector<simd::Isa> isas{simd::Isa::Scalar};
+  for (auto isa : {simd::Isa::Sse42, simd::Isa::Avx2, simd::Isa::Avx512}) {
+    if (isa <= best) isas.push_back(isa);
+  }
+
+  constexpr std::size_t textSize = 256 << 20;
+  std::mt19937 engine;
+  std::uniform_int_distribution<int> dist(' ', '~');
+  std::string text(textSize, ' ');
+  for (auto& c : text) c = static_cast<char>(dist(engine));
+
+  auto expected = text;
+  getThroughput("std::erase_if(isupper)", textSize, [&] {
+    std::erase_if(expected, [](char c) { return std::isupper(c); });
+  });
+  for (auto isa : isas) {
+    auto copy = text;
+    getThroughput("simd::erase_if(is_upper), " + std::string{name(isa)},
+                  textSize, [&] { simd::erase_if(copy, simd::is_upper, isa); });
+    if (copy != expected) std::cout << "Wrong result\n";
+  }
+
+  auto noSpaces = text;
+  std::erase_if(noSpaces, [](char c) { return std::isspace(c); });
+  auto copy = text;
+  simd::erase_if(copy, simd::is_space);
+  if (copy != noSpaces) std::cout << "Wrong result\n";
+
+  std::cout << '\n';
+
+  constexpr std::size_t intCount = 64 << 20;
+  std::vector<int> values(intCount);
+  std::uniform_int_distribution<int> intDist(-1000, 1000);
+  for (auto& v : values) v = intDist(engine);
+
+  auto square = [](int i) { return i * i; };
+  auto squared = values;
+  getThroughput("std::transform(square)", intCount * sizeof(int), [&] {
+    std::transform(squared.begin(), squared.end(), squared.begin(), square);
+  });
+  for (auto isa : isas) {
+    auto copy = values;
+    getThroughput("simd::transform(square), " + std::string{name(isa)},
+                  intCount * sizeof(int), [&] {
+                    simd::transform(std::span{copy}, square, isa);
+                  });
+    if (copy != squared) std::cout << "Wrong result\n";
+  }
+}
@@ -0,0 +1,289 @@
+// gcc 14
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace chr = std::chrono;
+using namespace std::literals;
+
+// Resolves every time zone once and remembers the offset intervals seen so
+// far, so converting a time point inside a known interval is one addition
+// instead of a tzdb lookup plus a sys_info search.
+class ZoneCache {
+ public:
+  class Zone {
+   public:
+    explicit Zone(const chr::time_zone* tz) : tz{tz} {}
+
+    const chr::time_zone* get_time_zone() const { return tz; }
+
+    chr::local_seconds to_local(chr::sys_seconds tp) {
+      const auto& interval = findSys(tp);
+      return chr::local_seconds{tp.time_since_epoch() + interval.offset};
+    }
+
+    // Converts a whole batch; consecutive time points in the same interval
+    // share one lookup and the inner loop is a plain vectorisable add.
+    void to_local(std::span<const chr::sys_seconds> in,
+                  std::span<chr::local_seconds> out) {
+      assert(in.size() <= out.size());
+      for (std::size_t i = 0; i < in.size();) {
+        const auto& interval = findSys(in[i]);
+        for (; i < in.size() && in[i] >= interval.begin && in[i] < interval.end;
+             ++i) {
+          out[i] =
+              chr::local_seconds{in[i].time_since_epoch() + interval.offset};
+        }
+      }
+    }
+
+    // The abbreviation of the zone at tp, like %Z of a zoned_time; valid
+    // as long as the cache
+    std::string_view abbrev(chr::sys_seconds tp) {
+      return abbrevs[findSys(tp).abbrev];
+    }
+
+    // Like zoned_time, throws for nonexistent or ambiguous local times.
+    chr::sys_seconds to_sys(chr::local_seconds tp) {
+      const auto* window = findLocal(tp);
+      if (window == nullptr) {
+        return tz->to_sys(tp);
+      }
+      return chr::sys_seconds{tp.time_since_epoch() - window->offset};
+    }
+
+   private:
+    template <typename TimePoint>
+    struct Interval {
+      TimePoint begin;
+      TimePoint end;
+      chr::seconds offset;
+    };
+
+    struct SysInterval : Interval<chr::sys_seconds> {
+      std::uint32_t abbrev;  // index into abbrevs
+    };
+
+    template <typename TimePoint, typename Value = Interval<TimePoint>>
+    struct Intervals {
+      std::vector<Value> sorted;
+      std::size_t last = 0;
+
+      // Returns the cached interval containing tp, or the position where
+      // an interval containing tp has to be inserted.
+      auto find(TimePoint tp) {
+        if (last < sorted.size() && sorted[last].begin <= tp &&
+            tp < sorted[last].end) {
+          return sorted.begin() + last;
+        }
+        auto pos = std::ranges::upper_bound(sorted, tp, std::less{},
+                                            &Value::begin);
+        if (pos != sorted.begin() && tp < std::prev(pos)->end) {
+          --pos;
+          last = pos - sorted.begin();
+        }
+        return pos;
+      }
+
+      bool contains(auto pos, TimePoint tp) const {
+        return pos != sorted.end() && pos->begin <= tp && tp < pos->end;
+      }
+
+      const Value& insert(auto pos, Value interval) {
+        pos = sorted.insert(pos, interval);
+        last = pos - sorted.begin();
+        return *pos;
+      }
+    };
+
+    const SysInterval& findSys(chr::sys_seconds tp) {
+      auto pos = sysIntervals.find(tp);
+      if (sysIntervals.contains(pos, tp)) {
+        return *pos;
+      }
+      const auto info = tz->get_info(tp);
+      return sysIntervals.insert(
+          pos, {{info.begin, info.end, info.offset}, intern(info.abbrev)});
+    }
+
+    // a zone only has a few abbreviations
+    std::uint32_t intern(const std::string& abbrev) {
+      const auto pos = std::ranges::find(abbrevs, abbrev);
+      if (pos == abbrevs.end()) abbrevs.push_back(abbrev);
+      return static_cast<std::uint32_t>(pos - abbrevs.begin());
+    }
+
+    // The local window of a sys_info interval is shrunk by the gap or
+    // overlap at both of its transitions, so every cached local time maps
+    // to exactly one sys time.
+    const Interval<chr::local_seconds>* findLocal(chr::local_seconds tp) {
+      auto pos = localIntervals.find(tp);
+      if (localIntervals.contains(pos, tp)) {
+        return &*pos;
+      }
+      const auto info = tz->get_info(tp);
+      if (info.result != chr::local_info::unique) {
+        return nullptr;
+      }
+      const auto& cur = info.first;
+      auto begin = chr::local_seconds::min();
+      if (cur.begin != chr::sys_seconds::min()) {
+        const auto prevOffset = tz->get_info(cur.begin - 1s).offset;
+        begin = chr::local_seconds{cur.begin.time_since_epoch() +
+                                   std::max(cur.offset, prevOffset)};
+      }
+      auto end = chr::local_seconds::max();
+      if (cur.end != chr::sys_seconds::max()) {
+        const auto nextOffset = tz->get_info(cur.end).offset;
+        end = chr::local_seconds{cur.end.time_since_epoch() +
+                                 std::min(cur.offset, nextOffset)};
+      }
+      return &localIntervals.insert(pos, {begin, end, cur.offset});
+    }
+
+    const chr::time_zone* tz;
+    Intervals<chr::sys_seconds, SysInterval> sysIntervals;
+    Intervals<chr::local_seconds> localIntervals;
+    std::deque<std::string> abbrevs;  // stable for abbrev()
+  };
+
+  Zone& zone(std::string_view name) {
+    auto pos = zones.find(name);
+    if (pos == zones.end()) {
+      pos = zones.emplace(std::string{name}, Zone{chr::locate_zone(name)})
+                .first;
+    }
+    return pos->second;
+  }
+
+ private:
+  std::map<std::string, Zone, std::less<>> zones;
+};
+
+// print() of 10_new_types_nntp with the zones resolved through the cache.
+// printStartEndTimes() of 2023/online_class builds zoned_time by name the
+// same way and could go through the cache like this.
+void print(std::ranges::input_range auto&& rg, ZoneCache& cache) {
+  auto& current = cache.zone(chr::current_zone()->name());
+  for (const auto& day : rg) {
+    std::cout << day << ":\n";
+    if (chr::weekday{day} == chr::Monday) {
+      std::cout << "I don't like Mondays\n";
+    }
+    // telco at noon local time
+    auto tpTelco{chr::local_days{day} + 12h};
+    const auto telco = current.to_sys(tpTelco);
+    for (auto tzName : {"Europe/Berlin", "America/Los_Angeles"}) {
+      auto& zone = cache.zone(tzName);
+      const auto local = zone.to_local(telco);
+      // cross-checked against zoned_time in debug builds only
+      assert((local == chr::zoned_time{tzName, chr::zoned_time{
+                                                   chr::current_zone(),
+                                                   tpTelco}}
+                           .get_local_time()));
+      std::cout << std::format(" {:%D %R} {}\n", local, zone.abbrev(telco));
+    }
+  }
+}
+
+template <typename Func>
+void getConversionRate(const std::string& title, std::size_t conversions,
+                       Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  const auto checksum = func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << conversions / dur.count() / 1e6
+            << " M conversions/sec. (checksum " << checksum << ")\n";
+}
+
+int main() {
+  ZoneCache cache;
+
+  std::array dates{10d / 11 / 2021, 2021y / 4 / 4, chr::November / 1 / 2021};
+  std::ranges::sort(dates);
+  print(dates, cache);
+
+  std::cout << '\n';
+
+  const std::vector<std::string_view> timeZones{
+      "America/Los_Angeles", "America/Denver",   "America/New_York",
+      "Europe/London",       "Europe/Berlin",    "Europe/Minsk",
+      "Europe/Moscow",       "Asia/Kolkata",     "Asia/Novosibirsk",
+      "Asia/Singapore",      "Australia/Perth",  "Australia/Sydney",
+      "America/Sao_Paulo",   "Africa/Cairo",     "Pacific/Auckland",
+      "Asia/Tokyo"};
+
+  // one year of time stamps, sorted as they arrive from a log
+  constexpr std::size_t size = 1'000'000;
+  const chr::sys_seconds first{chr::sys_days{2021y / 1 / 1}};
+  std::mt19937 engine;
+  std::uniform_int_distribution<std::int64_t> dist(0, 365 * 24 * 3600 - 1);
+  std::vector<chr::sys_seconds> timestamps(size);
+  for (auto& tp : timestamps) tp = first + chr::seconds{dist(engine)};
+  std::ranges::sort(timestamps);
+
+  const auto conversions = size * timeZones.size();
+
+  getConversionRate("zoned_time by name", conversions, [&] {
+    std::int64_t checksum = 0;
+    for (auto tzName : timeZones) {
+      for (auto tp : timestamps) {
+        checksum += chr::zoned_time{tzName, tp}
+                        .get_local_time()
+                        .time_since_epoch()
+                        .count();
+      }
+    }
+    return checksum;
+  });
+
+  getConversionRate("ZoneCache::Zone::to_local", conversions, [&] {
+    std::int64_t checksum = 0;
+    for (auto tzName : timeZones) {
+      auto& zone = cache.zone(tzName);
+      for (auto tp : timestamps) {
+        checksum += zone.to_local(tp).time_since_epoch().count();
+      }
+    }
+    return checksum;
+  });
+
+  getConversionRate("ZoneCache::Zone::to_local batch", conversions, [&] {
+    std::int64_t checksum = 0;
+    std::vector<chr::local_seconds> out(size);
+    for (auto tzName : timeZones) {
+      cache.zone(tzName).to_local(timestamps, out);
+      for (auto tp : out) checksum += tp.time_since_epoch().count();
+    }
+    return checksum;
+  });
+
+  std::ranges::shuffle(timestamps, engine);
+
+  getConversionRate("ZoneCache::Zone::to_local unsorted", conversions, [&] {
+    std::int64_t checksum = 0;
+    for (auto tzName : timeZones) {
+      auto& zone = cache.zone(tzName);
+      for (auto tp : timestamps) {
+        checksum += zone.to_local(tp).time_since_epoch().count();
+      }
+    }
+    return checksum;
+  });
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+// gcc 13.1
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+struct Coord {
+  double x, y, z;
+
+  auto operator<=>(const Coord&) const = default;
+  friend std::ostream& operator<<(std::ostream& out, const Coord& data) {
+    out << std::format("{}/{}/{}", data.x, data.y, data.z);
+    return out;
+  }
+};
+
+// Formats straight into the output iterator; the format spec applies to
+// every member, e.g. "{:.2f}" gives 1.00/2.00/3.00.
+template <>
+struct std::formatter<Coord> : std::formatter<double> {
+  template <typename FormatContext>
+  auto format(const Coord& data, FormatContext& ctx) const {
+    auto out = std::formatter<double>::format(data.x, ctx);
+    *out++ = '/';
+    ctx.advance_to(out);
+    out = std::formatter<double>::format(data.y, ctx);
+    *out++ = '/';
+    ctx.advance_to(out);
+    return std::formatter<double>::format(data.z, ctx);
+  }
+};
+
+// Collects formatted output in a reusable buffer and hands it to the stream
+// in large blocks instead of one small write per element.
+class BufferedSink {
+ public:
+  explicit BufferedSink(std::ostream& out, std::size_t blockSize = 1 << 20)
+      : out{out}, blockSize{blockSize} {
+    buffer.reserve(blockSize + blockSize / 4);
+  }
+
+  BufferedSink(const BufferedSink&) = delete;
+  BufferedSink& operator=(const BufferedSink&) = delete;
+
+  ~BufferedSink() { flush(); }
+
+  template <typename... Args>
+  void format_to(std::format_string<Args...> fmt, Args&&... args) {
+    std::format_to(std::back_inserter(buffer), fmt,
+                   std::forward<Args>(args)...);
+    if (buffer.size() >= blockSize) {
+      flush();
+    }
+  }
+
+  void flush() {
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+  }
+
+ private:
+  std::ostream& out;
+  std::size_t blockSize;
+  std::string buffer;
+};
+
+void print(const auto& rg) {
+  for (const auto& value : rg) {
+    std::cout << value << '\n';
+  }
+}
+
+void print(const auto& rg, BufferedSink& sink) {
+  for (const auto& value : rg) {
+    sink.format_to("{}\n", value);
+  }
+}
+
+// Discards everything, so only the formatting cost is measured.
+class NullBuffer : public std::streambuf {
+ protected:
+  int_type overflow(int_type ch) override { return ch; }
+  std::streamsize xsputn(const char*, std::streamsize count) override {
+    return count;
+  }
+};
+
+template <typename Func>
+void getThroughput(const std::string& title, std::size_t elements,
+                   Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << elements / dur.count() / 1e6
+            << " M elements/sec.\n";
+}
+
+int main() {
+  std::array points{Coord{1, 2, 3}, Coord{4, 5, 6}, Coord{0, 2, 0},
+                    Coord{0, 0, 2}};
+  std::ranges::sort(points);
+  print(points);
+  {
+    BufferedSink sink{std::cout};
+    print(points, sink);
+    sink.format_to("{:.2f}\n", points.front());
+  }
+
+  std::cout << '\n';
+
+  constexpr std::size_t size = 5'000'000;
+  std::mt19937 engine;
+  std::uniform_real_distribution<> dist(-1000, 1000);
+  std::vector<Coord> cloud(size);
+  for (auto& point : cloud) {
+    point = Coord{dist(engine), dist(engine), dist(engine)};
+  }
+
+  NullBuffer nullBuffer;
+  std::ostream null{&nullBuffer};
+
+  getThroughput("operator<<", size, [&] {
+    for (const auto& point : cloud) null << point << '\n';
+  });
+
+  getThroughput("std::format + write", size, [&] {
+    for (const auto& point : cloud) null << std::format("{}\n", point);
+  });
+
+  getThroughput("BufferedSink::format_to", size, [&] {
+    BufferedSink sink{null};
+    for (const auto& point : cloud) sink.format_to("{}\n", point);
+  });
+
+  using namespace std::chrono;
+  std::vector<sys_seconds> timestamps(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    timestamps[i] = sys_days{2021y / 1 / 1} + seconds(7 * i);
+  }
+
+  getThroughput("sys_seconds operator<<", size, [&] {
+    for (const auto& tp : timestamps) null << tp << '\n';
+  });
+
+  getThroughput("sys_seconds BufferedSink::format_to", size, [&] {
+    BufferedSink sink{null};
+    for (const auto& tp : timestamps) sink.format_to("{:%F %T}\n", tp);
+  });
+
+  return 0;
+}
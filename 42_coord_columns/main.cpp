@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+void print(const std::ranges::input_range auto& rg) {
+  for (const auto& value : rg) {
+    std::cout << value << '\n';
+  }
+}
+
+struct Coord {
+  double x, y, z;
+
+  auto operator<=>(const Coord&) const = default;
+};
+
+std::ostream& operator<<(std::ostream& out, const Coord& data) {
+  out << "{" << data.x << "," << data.y << "," << data.z << "}";
+  return out;
+}
+
+// Proxy for one element of a CoordBuffer: refers to the three columns and
+// behaves like a Coord& for reading, assigning and comparing.
+class CoordRef {
+ public:
+  CoordRef(double& x, double& y, double& z) : x{x}, y{y}, z{z} {}
+
+  operator Coord() const { return Coord{x, y, z}; }
+
+  const CoordRef& operator=(const Coord& value) const {
+    x = value.x;
+    y = value.y;
+    z = value.z;
+    return *this;
+  }
+
+  const CoordRef& operator=(const CoordRef& other) const {
+    return *this = Coord(other);
+  }
+
+  friend void swap(const CoordRef& lhs, const CoordRef& rhs) {
+    std::swap(lhs.x, rhs.x);
+    std::swap(lhs.y, rhs.y);
+    std::swap(lhs.z, rhs.z);
+  }
+
+  friend auto operator<=>(const CoordRef& lhs, const CoordRef& rhs) {
+    return Coord(lhs) <=> Coord(rhs);
+  }
+
+  friend bool operator==(const CoordRef& lhs, const CoordRef& rhs) {
+    return Coord(lhs) == Coord(rhs);
+  }
+
+  double& x;
+  double& y;
+  double& z;
+};
+
+// A CoordRef and a Coord meet in Coord, which is what lets std::ranges
+// algorithms mix values and proxies.
+template <template <typename> typename TQual,
+          template <typename> typename UQual>
+struct std::basic_common_reference<CoordRef, Coord, TQual, UQual> {
+  using type = Coord;
+};
+
+template <template <typename> typename TQual,
+          template <typename> typename UQual>
+struct std::basic_common_reference<Coord, CoordRef, TQual, UQual> {
+  using type = Coord;
+};
+
+// Structure of arrays: x, y and z live in separate contiguous columns, so a
+// scan over one coordinate only touches the bytes it needs.
+class CoordBuffer {
+ public:
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Coord;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<Const, Coord, CoordRef>;
+    using Column = std::conditional_t<Const, const double*, double*>;
+
+    Iterator() = default;
+    Iterator(Column x, Column y, Column z, difference_type pos)
+        : x{x}, y{y}, z{z}, pos{pos} {}
+
+    reference operator*() const { return {x[pos], y[pos], z[pos]}; }
+    reference operator[](difference_type n) const { return *(*this + n); }
+
+    Iterator& operator++() {
+      ++pos;
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto tmp = *this;
+      ++pos;
+      return tmp;
+    }
+    Iterator& operator--() {
+      --pos;
+      return *this;
+    }
+    Iterator operator--(int) {
+      auto tmp = *this;
+      --pos;
+      return tmp;
+    }
+    Iterator& operator+=(difference_type n) {
+      pos += n;
+      return *this;
+    }
+    Iterator& operator-=(difference_type n) {
+      pos -= n;
+      return *this;
+    }
+
+    friend Iterator operator+(Iterator it, difference_type n) {
+      return it += n;
+    }
+    friend Iterator operator+(difference_type n, Iterator it) {
+      return it += n;
+    }
+    friend Iterator operator-(Iterator it, difference_type n) {
+      return it -= n;
+    }
+    friend difference_type operator-(const Iterator& lhs,
+                                      const Iterator& rhs) {
+      return lhs.pos - rhs.pos;
+    }
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.pos == rhs.pos;
+    }
+    friend auto operator<=>(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.pos <=> rhs.pos;
+    }
+
+    friend Coord iter_move(const Iterator& it) { return *it; }
+
+    friend void iter_swap(const Iterator& lhs, const Iterator& rhs)
+      requires(!Const)
+    {
+      swap(*lhs, *rhs);
+    }
+
+   private:
+    Column x = nullptr;
+    Column y = nullptr;
+    Column z = nullptr;
+    difference_type pos = 0;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  CoordBuffer() = default;
+  explicit CoordBuffer(std::ranges::input_range auto&& coords) {
+    if constexpr (std::ranges::sized_range<decltype(coords)>) {
+      reserve(std::ranges::size(coords));
+    }
+    for (const Coord& coord : coords) push_back(coord);
+  }
+
+  void reserve(std::size_t n) {
+    xs.reserve(n);
+    ys.reserve(n);
+    zs.reserve(n);
+  }
+
+  void push_back(const Coord& coord) {
+    xs.push_back(coord.x);
+    ys.push_back(coord.y);
+    zs.push_back(coord.z);
+  }
+
+  std::size_t size() const { return xs.size(); }
+
+  CoordRef operator[](std::size_t pos) { return {xs[pos], ys[pos], zs[pos]}; }
+  Coord operator[](std::size_t pos) const {
+    return {xs[pos], ys[pos], zs[pos]};
+  }
+
+  iterator begin() { return {xs.data(), ys.data(), zs.data(), 0}; }
+  iterator end() { return begin() + std::ssize(xs); }
+  const_iterator begin() const { return {xs.data(), ys.data(), zs.data(), 0}; }
+  const_iterator end() const { return begin() + std::ssize(xs); }
+
+  std::span<double> x() { return xs; }
+  std::span<double> y() { return ys; }
+  std::span<double> z() { return zs; }
+  std::span<const double> x() const { return xs; }
+  std::span<const double> y() const { return ys; }
+  std::span<const double> z() const { return zs; }
+
+ private:
+  std::vector<double> xs;
+  std::vector<double> ys;
+  std::vector<double> zs;
+};
+
+static_assert(std::ranges::random_access_range<CoordBuffer>);
+static_assert(std::ranges::random_access_range<const CoordBuffer>);
+static_assert(std::sortable<CoordBuffer::iterator>);
+
+// Maps a double to an unsigned integer with the same order; -0.0 and 0.0
+// get the same key as they compare equal. NaNs are not supported.
+std::uint64_t sortKey(double value) {
+  constexpr std::uint64_t signBit = std::uint64_t{1} << 63;
+  const auto bits = std::bit_cast<std::uint64_t>(value + 0.0);
+  return (bits & signBit) ? ~bits : (bits | signBit);
+}
+
+double fromSortKey(std::uint64_t key) {
+  constexpr std::uint64_t signBit = std::uint64_t{1} << 63;
+  return std::bit_cast<double>((key & signBit) ? (key & ~signBit) : ~key);
+}
+
+// x, y and z keys packed in sort order, compared as one 192-bit number.
+// The fourth word only remembers which of the values were -0.0, which
+// share their key with 0.0.
+using PackedKey = std::array<std::uint64_t, 4>;
+
+std::uint64_t negativeZero(double value) {
+  return value == 0.0 && std::signbit(value);
+}
+
+unsigned keyByte(const PackedKey& key, int pos) {
+  return (key[pos / 8] >> (56 - 8 * (pos % 8))) & 0xFF;
+}
+
+// Most significant digit first radix sort on the packed key bytes. Bytes
+// shared by the whole bucket are skipped, small buckets are left to
+// std::sort.
+void radixSort(PackedKey* keys, PackedKey* tmp, std::size_t size, int pos) {
+  constexpr std::size_t minRadixSize = 64;
+  while (size > minRadixSize && pos < 24) {
+    std::array<std::size_t, 256> counts{};
+    for (std::size_t i = 0; i < size; ++i) ++counts[keyByte(keys[i], pos)];
+    if (counts[keyByte(keys[0], pos)] == size) {
+      ++pos;
+      continue;
+    }
+    std::array<std::size_t, 256> offsets;
+    std::exclusive_scan(counts.begin(), counts.end(), offsets.begin(),
+                        std::size_t{0});
+    for (std::size_t i = 0; i < size; ++i) {
+      tmp[offsets[keyByte(keys[i], pos)]++] = keys[i];
+    }
+    std::copy(tmp, tmp + size, keys);
+    std::size_t start = 0;
+    for (auto count : counts) {
+      if (count > 1) {
+        radixSort(keys + start, tmp + start, count, pos + 1);
+      }
+      start += count;
+    }
+    return;
+  }
+  std::sort(keys, keys + size);
+}
+
+// Lexicographic sort of the columns: pack every element into an integer
+// key, radix sort the keys and unpack them back into the columns.
+void radixSort(CoordBuffer& buffer) {
+  const auto size = buffer.size();
+  const auto xs = buffer.x();
+  const auto ys = buffer.y();
+  const auto zs = buffer.z();
+  std::vector<PackedKey> keys(size);
+  std::vector<PackedKey> tmp(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    keys[i] = {sortKey(xs[i]), sortKey(ys[i]), sortKey(zs[i]),
+               negativeZero(xs[i]) | negativeZero(ys[i]) << 1 |
+                   negativeZero(zs[i]) << 2};
+  }
+  radixSort(keys.data(), tmp.data(), size, 0);
+  for (std::size_t i = 0; i < size; ++i) {
+    const auto zeros = keys[i][3];
+    xs[i] = zeros & 1 ? -0.0 : fromSortKey(keys[i][0]);
+    ys[i] = zeros & 2 ? -0.0 : fromSortKey(keys[i][1]);
+    zs[i] = zeros & 4 ? -0.0 : fromSortKey(keys[i][2]);
+  }
+}
+
+template <typename Func>
+void getExecutionTime(const std::string& title, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec. " << std::endl;
+}
+
+int main() {
+  CoordBuffer points{std::vector{Coord{1, 2, 3}, Coord{4, 5, 6},
+                                 Coord{0, 2, 0}, Coord{0, 0, 2}}};
+  std::ranges::sort(points);
+  print(points);
+  print(points | std::views::drop(1));
+
+  std::cout << '\n';
+
+  constexpr std::size_t size = 10'000'000;
+  std::mt19937 engine;
+  // few distinct x values, so y and z take part in the ordering
+  std::uniform_int_distribution<> coarse(0, 99);
+  std::uniform_real_distribution<> fine(-1000, 1000);
+  std::vector<Coord> cloud(size);
+  for (auto& point : cloud) {
+    point = Coord{double(coarse(engine)), fine(engine), fine(engine)};
+  }
+
+  auto aos = cloud;
+  CoordBuffer soa{cloud};
+  CoordBuffer soaRadix{cloud};
+
+  getExecutionTime("std::vector<Coord> std::ranges::sort",
+                   [&] { std::ranges::sort(aos); });
+  getExecutionTime("CoordBuffer std::ranges::sort",
+                   [&] { std::ranges::sort(soa); });
+  getExecutionTime("CoordBuffer radixSort", [&] { radixSort(soaRadix); });
+
+  if (!std::ranges::equal(aos, soa) || !std::ranges::equal(aos, soaRadix)) {
+    std::cout << "Sort results differ\n";
+    return 1;
+  }
+
+  double sum = 0;
+  getExecutionTime("std::vector<Coord> sum of x", [&] {
+    sum = std::accumulate(aos.begin(), aos.end(), 0.0,
+                          [](double acc, const Coord& c) { return acc + c.x; });
+  });
+  std::cout << "  " << sum << '\n';
+  getExecutionTime("CoordBuffer sum of x", [&] {
+    sum = std::accumulate(soa.x().begin(), soa.x().end(), 0.0);
+  });
+  std::cout << "  " << sum << '\n';
+
+  return 0;
+}
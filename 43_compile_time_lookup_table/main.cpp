@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+template <typename T, std::size_t N>
+consteval std::size_t countUnique(std::array<T, N> keys) {
+  std::ranges::sort(keys);
+  return std::ranges::unique(keys).begin() - keys.begin();
+}
+
+// Sorted and deduplicated copy of Keys, sized at compile time
+template <auto Keys>
+consteval auto sortedUnique() {
+  using T = typename decltype(Keys)::value_type;
+
+  // Create compile time vector
+  std::vector<T> v{Keys.begin(), Keys.end()};
+  std::ranges::sort(v);
+  auto [first, last] = std::ranges::unique(v);
+  v.erase(first, last);
+
+  std::array<T, countUnique(Keys)> arr{};
+  std::ranges::copy(v, arr.begin());
+  return arr;
+}
+
+// Sorted keys in breadth-first (Eytzinger) order: the root is at index 1,
+// the children of k are at 2k and 2k+1. The first levels of the search
+// share a few cache lines and the loop has no data dependent branch.
+template <auto Keys>
+class EytzingerSet {
+ public:
+  using value_type = typename decltype(Keys)::value_type;
+
+  static bool contains(value_type key) {
+    std::size_t k = 1;
+    while (k < table.size()) {
+      k = 2 * k + (table[k] < key);
+    }
+    // drop the trailing right turns and the final left turn
+    k >>= std::countr_one(k) + 1;
+    return k != 0 && table[k] == key;
+  }
+
+ private:
+  static constexpr auto sorted = sortedUnique<Keys>();
+
+  static consteval void fill(auto& table, std::size_t& pos, std::size_t k) {
+    if (k < table.size()) {
+      fill(table, pos, 2 * k);
+      table[k] = sorted[pos++];
+      fill(table, pos, 2 * k + 1);
+    }
+  }
+
+  static consteval auto build() {
+    std::array<value_type, sorted.size() + 1> table{};
+    std::size_t pos = 0;
+    fill(table, pos, 1);
+    return table;
+  }
+
+  static constexpr auto table = build();
+};
+
+constexpr std::uint64_t mix(std::uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// Maps a hash to [0, n) without a division
+constexpr std::size_t reduce(std::uint64_t hash, std::size_t n) {
+  return ((hash >> 32) * n) >> 32;
+}
+
+// Only called when PerfectHashSet finds no seed for a bucket, so the
+// compile-time evaluation fails with this name in the error instead of
+// running into the constexpr step limit
+void perfectHashSeedSearchFailed() {}
+
+// Minimal perfect hash by hash and displace: keys are grouped into buckets
+// and every bucket gets a seed that sends its keys to free slots of an
+// array with exactly one slot per key. A lookup reads one seed and one
+// slot.
+template <auto Keys>
+  requires std::integral<typename decltype(Keys)::value_type>
+class PerfectHashSet {
+ public:
+  using value_type = typename decltype(Keys)::value_type;
+
+  static bool contains(value_type key) {
+    const auto hash = mix(static_cast<std::uint64_t>(key));
+    const auto seed = table.seeds[reduce(hash, bucketCount)];
+    return table.slots[slot(hash, seed)] == key;
+  }
+
+ private:
+  static constexpr auto keys = sortedUnique<Keys>();
+  static constexpr std::size_t bucketCount = keys.size() / 2 + 1;
+  // far more than a bucket needs, and far below the constexpr step limit
+  static constexpr std::uint32_t maxSeed = 1 << 16;
+
+  static constexpr std::size_t slot(std::uint64_t hash, std::uint32_t seed) {
+    return reduce(mix(hash + seed * 0x9e3779b97f4a7c15ULL), keys.size());
+  }
+
+  struct Table {
+    std::array<std::uint32_t, bucketCount> seeds;
+    std::array<value_type, keys.size()> slots;
+  };
+
+  static consteval Table build() {
+    std::vector<std::vector<std::uint64_t>> buckets(bucketCount);
+    for (auto key : keys) {
+      const auto hash = mix(static_cast<std::uint64_t>(key));
+      buckets[reduce(hash, bucketCount)].push_back(hash);
+    }
+
+    // place the large buckets first while there are many free slots
+    std::vector<std::size_t> order(bucketCount);
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::ranges::sort(order, [&](auto lhs, auto rhs) {
+      return buckets[lhs].size() != buckets[rhs].size()
+                 ? buckets[lhs].size() > buckets[rhs].size()
+                 : lhs < rhs;
+    });
+
+    Table table{};
+    std::vector<bool> taken(keys.size());
+    std::vector<std::size_t> placed;
+    for (auto b : order) {
+      for (std::uint32_t seed = 0;; ++seed) {
+        if (seed == maxSeed) perfectHashSeedSearchFailed();
+        placed.clear();
+        for (auto hash : buckets[b]) {
+          const auto pos = slot(hash, seed);
+          if (taken[pos] || std::ranges::find(placed, pos) != placed.end()) {
+            break;
+          }
+          placed.push_back(pos);
+        }
+        if (placed.size() == buckets[b].size()) {
+          table.seeds[b] = seed;
+          for (auto pos : placed) taken[pos] = true;
+          break;
+        }
+      }
+    }
+
+    for (auto key : keys) {
+      const auto hash = mix(static_cast<std::uint64_t>(key));
+      table.slots[slot(hash, table.seeds[reduce(hash, bucketCount)])] = key;
+    }
+    return table;
+  }
+
+  static constexpr Table table = build();
+};
+
+// HTTP status codes, unsorted and with a duplicate
+constexpr std::array statusCodes{
+    100, 101, 102, 103, 200, 201, 202, 203, 204, 205, 206, 207, 208, 226,
+    300, 301, 302, 303, 304, 305, 307, 308, 400, 401, 402, 403, 404, 405,
+    406, 407, 408, 409, 410, 411, 412, 413, 414, 415, 416, 417, 418, 421,
+    422, 423, 424, 425, 426, 428, 429, 431, 451, 500, 501, 502, 503, 504,
+    505, 506, 507, 508, 510, 511, 404};
+
+template <typename Func>
+void getLookupTime(const std::string& title, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  const auto hits = func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec. (" << hits
+            << " hits)\n";
+}
+
+int main() {
+  using Eytzinger = EytzingerSet<statusCodes>;
+  using PerfectHash = PerfectHashSet<statusCodes>;
+
+  constexpr auto sorted = sortedUnique<statusCodes>();
+  for (int code = 0; code < 1000; ++code) {
+    const bool expected = std::ranges::binary_search(sorted, code);
+    if (Eytzinger::contains(code) != expected ||
+        PerfectHash::contains(code) != expected) {
+      std::cout << "Wrong lookup result for " << code << '\n';
+      return 1;
+    }
+  }
+  std::cout << sorted.size() << " status codes\n\n";
+
+  constexpr std::size_t size = 20'000'000;
+  std::mt19937 engine;
+  std::uniform_int_distribution<> dist(100, 599);
+  std::vector<int> queries(size);
+  for (auto& query : queries) query = dist(engine);
+
+  const std::set<int> set(sorted.begin(), sorted.end());
+  const std::unordered_set<int> unorderedSet(sorted.begin(), sorted.end());
+
+  auto countHits = [&](auto contains) {
+    std::size_t hits = 0;
+    for (auto query : queries) hits += contains(query);
+    return hits;
+  };
+
+  getLookupTime("std::set", [&] {
+    return countHits([&](int key) { return set.contains(key); });
+  });
+  getLookupTime("std::unordered_set", [&] {
+    return countHits([&](int key) { return unorderedSet.contains(key); });
+  });
+  getLookupTime("std::ranges::binary_search", [&] {
+    return countHits(
+        [&](int key) { return std::ranges::binary_search(sorted, key); });
+  });
+  getLookupTime("EytzingerSet", [&] {
+    return countHits([](int key) { return Eytzinger::contains(key); });
+  });
+  getLookupTime("PerfectHashSet", [&] {
+    return countHits([](int key) { return PerfectHash::contains(key); });
+  });
+
+  return 0;
+}
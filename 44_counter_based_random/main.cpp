@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+constexpr std::uint64_t rotate32(std::uint64_t x) {
+  return (x >> 32) | (x << 32);
+}
+
+// Squares counter-based RNG (Widynski 2020): the n-th output is a pure
+// function of the counter n and the key, so every element of a range can
+// be generated on its own, in any order and on any thread.
+constexpr std::uint32_t squares32(std::uint64_t ctr, std::uint64_t key) {
+  auto x = ctr * key;
+  const auto y = x;
+  const auto z = y + key;
+  x = rotate32(x * x + y);
+  x = rotate32(x * x + z);
+  x = rotate32(x * x + y);
+  return static_cast<std::uint32_t>((x * x + z) >> 32);
+}
+
+constexpr std::uint64_t squares64(std::uint64_t ctr, std::uint64_t key) {
+  auto x = ctr * key;
+  const auto y = x;
+  const auto z = y + key;
+  x = rotate32(x * x + y);
+  x = rotate32(x * x + z);
+  x = rotate32(x * x + y);
+  const auto t = x = x * x + z;
+  x = rotate32(x);
+  return t ^ ((x * x + y) >> 32);
+}
+
+// Keys should be odd and have well mixed bits, so the seed is run through
+// splitmix64 first
+constexpr std::uint64_t makeKey(std::uint64_t seed) {
+  seed += 0x9e3779b97f4a7c15ULL;
+  seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+  return (seed ^ (seed >> 31)) | 1;
+}
+
+// UniformRandomBitGenerator walking the counter sequence of one key
+class SquaresEngine {
+ public:
+  using result_type = std::uint32_t;
+
+  constexpr SquaresEngine(std::uint64_t key, std::uint64_t counter = 0)
+      : key{key}, counter{counter} {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  constexpr result_type operator()() { return squares32(counter++, key); }
+  constexpr void discard(unsigned long long n) { counter += n; }
+
+ private:
+  std::uint64_t key;
+  std::uint64_t counter;
+};
+
+template <typename Dist>
+constexpr bool isUniformInt = false;
+template <typename T>
+constexpr bool isUniformInt<std::uniform_int_distribution<T>> = true;
+
+template <typename Dist>
+constexpr bool isUniformReal = false;
+template <typename T>
+constexpr bool isUniformReal<std::uniform_real_distribution<T>> = true;
+
+// Fills rg[i] with a value that only depends on the distribution, the seed
+// and i, so the output is the same for any number of threads.
+// Uniform distributions are mapped straight from squares32/squares64 of i
+// with a multiply instead of a rejection loop; the branch free loop
+// vectorises where the target has 64-bit vector multiplies (AVX-512).
+// The bias of the integer mapping is below range / 2^32.
+// Any other distribution gets a fresh copy of itself and an engine
+// starting at counter i * 2^16 for every element.
+template <std::ranges::random_access_range Range, typename Dist>
+  requires std::ranges::sized_range<Range> &&
+           std::ranges::output_range<Range, typename Dist::result_type>
+void parallel_fill_random(
+    Range&& rg, const Dist& dist, std::uint64_t seed,
+    unsigned numberThreads = std::max(1u,
+                                      std::thread::hardware_concurrency())) {
+  using Value = std::ranges::range_value_t<Range>;
+  using Result = typename Dist::result_type;
+  constexpr std::size_t chunkSize = 1 << 16;
+
+  const auto size = static_cast<std::size_t>(std::ranges::size(rg));
+  const auto key = makeKey(seed);
+  const auto first = std::ranges::begin(rg);
+
+  auto fillChunk = [&](std::size_t begin, std::size_t end) {
+    auto out = first + begin;
+    if constexpr (isUniformInt<Dist>) {
+      using Unsigned = std::make_unsigned_t<Result>;
+      const auto low = static_cast<Unsigned>(dist.a());
+      const std::uint64_t range =
+          static_cast<Unsigned>(static_cast<Unsigned>(dist.b()) - low) + 1ULL;
+      if (range != 0 && range <= (1ULL << 32)) {
+        for (auto i = begin; i < end; ++i, ++out) {
+          const auto offset = (squares32(i, key) * range) >> 32;
+          *out = static_cast<Value>(static_cast<Result>(low + offset));
+        }
+        return;
+      }
+    } else if constexpr (isUniformReal<Dist>) {
+      // as many random bits as Result has digits, so unit stays below 1;
+      // low + unit * width can still round up to b, which is kept out
+      constexpr int digits = std::min(std::numeric_limits<Result>::digits, 64);
+      const auto scale = std::ldexp(Result{1}, -digits);
+      const auto low = dist.a();
+      const auto width = dist.b() - dist.a();
+      const auto high = dist.b();
+      const auto below = std::nextafter(high, low);
+      for (auto i = begin; i < end; ++i, ++out) {
+        const auto unit =
+            static_cast<Result>(squares64(i, key) >> (64 - digits)) * scale;
+        const auto value = low + unit * width;
+        *out = static_cast<Value>(value < high ? value : below);
+      }
+      return;
+    }
+    for (auto i = begin; i < end; ++i, ++out) {
+      SquaresEngine engine{key, i << 16};
+      auto elementDist = dist;
+      *out = static_cast<Value>(elementDist(engine));
+    }
+  };
+
+  const auto chunks = (size + chunkSize - 1) / chunkSize;
+  numberThreads = static_cast<unsigned>(std::clamp<std::size_t>(
+      numberThreads, 1, std::max<std::size_t>(chunks, 1)));
+  std::atomic<std::size_t> nextChunk{0};
+  auto work = [&] {
+    for (auto chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+      fillChunk(chunk * chunkSize, std::min(size, (chunk + 1) * chunkSize));
+    }
+  };
+  std::vector<std::jthread> workers;
+  for (unsigned t = 1; t < numberThreads; ++t) workers.emplace_back(work);
+  work();
+}
+
+// randomInit from 38_threads_stop_token without the stop token: there the
+// destructor of each jthread requests a stop, so the threads leave most of
+// the elements untouched and the time says nothing about the fill
+void randomInit(std::ranges::forward_range auto& values) requires
+    std::integral<std::ranges::range_value_t<decltype(values)>> {
+  auto init = [&] {
+    std::random_device rd;
+    std::default_random_engine dre{rd()};
+    std::uniform_int_distribution<int> random{1, 10};
+
+    for (auto& v : values) {
+      std::atomic_ref{v} += random(dre);
+    }
+  };
+
+  std::vector<std::jthread> threads;
+  for (int i = 0; i < 5; i++) {
+    threads.push_back(std::jthread{init});
+  }
+}
+
+void print(const std::ranges::input_range auto& coll) {
+  for (const auto& elem : coll) {
+    std::cout << elem << ' ';
+  }
+  std::cout << '\n';
+}
+
+template <typename Func>
+void getFillRate(const std::string& title, std::size_t bytes, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec. ("
+            << bytes / dur.count() / 1e9 << " GB/s)\n";
+}
+
+int main() {
+  std::uniform_int_distribution<> uniformDist(1, 10);
+
+  std::vector col1{0, 0, 0, 0, 0, 0, 0, 0};
+  parallel_fill_random(col1, uniformDist, 2021);
+  print(col1);
+
+  std::vector<double> normals(8);
+  parallel_fill_random(normals, std::normal_distribution<>{0, 1}, 2021);
+  print(normals);
+
+  std::cout << '\n';
+
+  constexpr std::size_t size = 100'000'000;
+  constexpr auto bytes = size * sizeof(int);
+
+  std::vector<int> randValues;
+  randValues.reserve(size);
+  getFillRate("std::mt19937, one thread", bytes, [&] {
+    std::random_device seed;
+    std::mt19937 engine(seed());
+    for (std::size_t i = 0; i < size; ++i) {
+      randValues.push_back(uniformDist(engine));
+    }
+  });
+
+  std::vector<int> added(size);
+  getFillRate("randomInit, 5 threads + atomic_ref", bytes,
+              [&] { randomInit(added); });
+
+  std::vector<int> single(size);
+  getFillRate("parallel_fill_random, 1 thread", bytes,
+              [&] { parallel_fill_random(single, uniformDist, 2021, 1); });
+
+  std::vector<int> parallel(size);
+  getFillRate(
+      "parallel_fill_random, " +
+          std::to_string(std::thread::hardware_concurrency()) + " threads",
+      bytes, [&] { parallel_fill_random(parallel, uniformDist, 2021); });
+
+  std::vector<double> reals(size);
+  getFillRate("parallel_fill_random, uniform_real_distribution", bytes * 2,
+              [&] {
+                parallel_fill_random(
+                    reals, std::uniform_real_distribution<>{0, 1}, 2021);
+              });
+
+  std::vector<double> gaussians(size / 10);
+  getFillRate("parallel_fill_random, normal_distribution", bytes / 5, [&] {
+    parallel_fill_random(gaussians, std::normal_distribution<>{0, 1}, 2021);
+  });
+
+  std::vector<double> gaussiansTwoThreads(size / 10);
+  parallel_fill_random(gaussiansTwoThreads, std::normal_distribution<>{0, 1},
+                       2021, 2);
+
+  if (single != parallel || gaussians != gaussiansTwoThreads) {
+    std::cout << "Output depends on the number of threads\n";
+    return 1;
+  }
+
+  return 0;
+}
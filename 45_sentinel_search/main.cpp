@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <numeric>
+#include <ranges>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+void print(const std::ranges::input_range auto& coll) {
+  for (const auto& elem : coll) {
+    std::cout << elem << ' ';
+  }
+  std::cout << '\n';
+}
+
+template <auto Val>
+struct EndValue {
+  bool operator==(auto pos) const { return *pos == Val; }
+};
+
+struct Coord {
+  double x, y, z;
+
+  auto operator<=>(const Coord&) const = default;
+};
+
+std::ostream& operator<<(std::ostream& out, const Coord& data) {
+  out << "{" << data.x << "," << data.y << "," << data.z << "}";
+  return out;
+}
+
+template <typename T>
+concept VectorComparable =
+    std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+    (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+#if defined(__x86_64__)
+
+// One bit per byte of every element equal to val
+template <VectorComparable T>
+unsigned matchBytes(__m128i v, T val) {
+  if constexpr (std::is_same_v<T, float>) {
+    return _mm_movemask_epi8(_mm_castps_si128(
+        _mm_cmpeq_ps(_mm_castsi128_ps(v), _mm_set1_ps(val))));
+  } else if constexpr (std::is_same_v<T, double>) {
+    return _mm_movemask_epi8(_mm_castpd_si128(
+        _mm_cmpeq_pd(_mm_castsi128_pd(v), _mm_set1_pd(val))));
+  } else if constexpr (sizeof(T) == 1) {
+    return _mm_movemask_epi8(
+        _mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(val))));
+  } else if constexpr (sizeof(T) == 2) {
+    return _mm_movemask_epi8(
+        _mm_cmpeq_epi16(v, _mm_set1_epi16(static_cast<short>(val))));
+  } else if constexpr (sizeof(T) == 4) {
+    return _mm_movemask_epi8(
+        _mm_cmpeq_epi32(v, _mm_set1_epi32(static_cast<int>(val))));
+  } else {
+    // SSE2 has no 64-bit compare: both 32-bit halves have to match
+    const auto eq = _mm_cmpeq_epi32(
+        v, _mm_set1_epi64x(static_cast<long long>(val)));
+    return _mm_movemask_epi8(
+        _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1))));
+  }
+}
+
+template <VectorComparable T>
+__attribute__((target("avx2"))) unsigned matchBytes(__m256i v, T val) {
+  if constexpr (std::is_same_v<T, float>) {
+    return _mm256_movemask_epi8(_mm256_castps_si256(_mm256_cmp_ps(
+        _mm256_castsi256_ps(v), _mm256_set1_ps(val), _CMP_EQ_OQ)));
+  } else if constexpr (std::is_same_v<T, double>) {
+    return _mm256_movemask_epi8(_mm256_castpd_si256(_mm256_cmp_pd(
+        _mm256_castsi256_pd(v), _mm256_set1_pd(val), _CMP_EQ_OQ)));
+  } else if constexpr (sizeof(T) == 1) {
+    return _mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(static_cast<char>(val))));
+  } else if constexpr (sizeof(T) == 2) {
+    return _mm256_movemask_epi8(
+        _mm256_cmpeq_epi16(v, _mm256_set1_epi16(static_cast<short>(val))));
+  } else if constexpr (sizeof(T) == 4) {
+    return _mm256_movemask_epi8(
+        _mm256_cmpeq_epi32(v, _mm256_set1_epi32(static_cast<int>(val))));
+  } else {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi64(
+        v, _mm256_set1_epi64x(static_cast<long long>(val))));
+  }
+}
+
+// Like rawmemchr: there is no end, so the loads are aligned to their own
+// size and never touch a page the terminator is not on. They may read
+// past the terminator, which the language does not allow but the
+// hardware does, so the address sanitizer is switched off here.
+template <typename Vec, VectorComparable T>
+__attribute__((always_inline, no_sanitize_address)) inline const T*
+findAligned(const T* pos, T val) {
+  constexpr auto width = sizeof(Vec);
+  while (reinterpret_cast<std::uintptr_t>(pos) % width != 0) {
+    if (*pos == val) return pos;
+    ++pos;
+  }
+  for (;; pos += width / sizeof(T)) {
+    const auto v = *reinterpret_cast<const Vec*>(pos);
+    if (const auto mask = matchBytes(v, val)) {
+      return pos + std::countr_zero(mask) / sizeof(T);
+    }
+  }
+}
+
+template <VectorComparable T>
+__attribute__((target("avx2"))) const T* findAvx2(const T* pos, T val) {
+  return findAligned<__m256i>(pos, val);
+}
+
+#endif
+
+// First element equal to val; the caller guarantees that there is one
+template <VectorComparable T>
+const T* findTerminator(const T* pos, T val) {
+#if defined(__x86_64__)
+  static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+  return hasAvx2 ? findAvx2(pos, val) : findAligned<__m128i>(pos, val);
+#else
+  while (!(*pos == val)) ++pos;
+  return pos;
+#endif
+}
+
+// Whether the elements equal to Val are exactly those equal to Val
+// converted to T, with the same conversions as in EndValue; not so for -1
+// and unsigned char, which is promoted and never compares equal to -1
+template <typename T, auto Val>
+constexpr bool searchableAs = [] {
+  if constexpr (VectorComparable<T> && std::is_arithmetic_v<decltype(Val)>) {
+    using Common = decltype(static_cast<T>(Val) + Val);
+    return static_cast<Common>(static_cast<T>(Val)) == static_cast<Common>(Val);
+  } else {
+    return false;
+  }
+}();
+
+// Turns subrange{first, EndValue<Val>{}} into a sized range, so the loops
+// of later views and algorithms know their trip count. For contiguous
+// arithmetic elements the terminator is searched with vector compares,
+// otherwise one element at a time, counting them where the iterators
+// cannot tell their distance.
+struct ToSized {
+  template <std::input_or_output_iterator It, auto Val,
+            std::ranges::subrange_kind Kind>
+  auto operator()(std::ranges::subrange<It, EndValue<Val>, Kind> rg) const {
+    using T = std::iter_value_t<It>;
+    auto first = rg.begin();
+    if constexpr (std::contiguous_iterator<It> && searchableAs<T, Val>) {
+      const auto data = std::to_address(first);
+      const auto last = findTerminator<T>(data, static_cast<T>(Val)) - data;
+      return std::span{data, static_cast<std::size_t>(last)};
+    } else if constexpr (std::sized_sentinel_for<It, It>) {
+      auto last = std::ranges::find(first, std::unreachable_sentinel, Val);
+      return std::ranges::subrange{first, last};
+    } else {
+      auto last = first;
+      std::make_unsigned_t<std::iter_difference_t<It>> n = 0;
+      for (; !(*last == Val); ++last) ++n;
+      return std::ranges::subrange{first, last, n};
+    }
+  }
+
+  template <typename Range>
+    requires std::invocable<const ToSized&, Range>
+  friend auto operator|(Range&& rg, const ToSized& toSized) {
+    return toSized(std::forward<Range>(rg));
+  }
+};
+
+inline constexpr ToSized to_sized;
+
+template <typename Func>
+void getScanTime(const std::string& title, std::size_t bytes, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  const auto result = func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec. ("
+            << bytes / dur.count() / 1e9 << " GB/s, " << result << ")\n";
+}
+
+int main() {
+  std::vector<int> col1{0, 8, 15, 47, 11, -1, 13};
+
+  std::ranges::subrange rg{col1.begin() + 1, EndValue<-1>{}};
+  auto sized = rg | to_sized;
+  static_assert(std::ranges::sized_range<decltype(sized)>);
+  print(sized);
+  print(sized | std::views::take(3) |
+        std::views::transform([](auto v) { return std::to_string(v) + 's'; }));
+
+  std::array points{Coord{1, 2, 3}, Coord{4, 5, 6}, Coord{0, 2, 0},
+                    Coord{0, 0, 2}};
+  std::ranges::sort(points);
+  print(std::ranges::subrange{points.begin(), EndValue<Coord{4, 5, 6}>{}} |
+        to_sized);
+
+  char text[] = "sentinel search";
+  print(std::ranges::subrange{text + 0, EndValue<' '>{}} | to_sized);
+
+  std::list<int> col2{3, 1, 4, 1, 5, -1, 9};
+  auto sizedList = std::ranges::subrange{col2.begin(), EndValue<-1>{}} |
+                   to_sized;
+  static_assert(std::ranges::sized_range<decltype(sizedList)>);
+  print(sizedList);
+
+  std::cout << '\n';
+
+  // 1 GB of ints, terminated by -1 in the last element
+  constexpr std::size_t size = (std::size_t{1} << 30) / sizeof(int);
+  std::vector<int> values(size);
+  std::iota(values.begin(), values.end() - 1, 0);
+  values.back() = -1;
+
+  std::ranges::subrange terminated{values.begin(), EndValue<-1>{}};
+  constexpr auto bytes = size * sizeof(int);
+
+  getScanTime("distance over EndValue", bytes,
+              [&] { return std::ranges::distance(terminated); });
+  getScanTime("to_sized", bytes,
+              [&] { return std::ranges::size(terminated | to_sized); });
+
+  getScanTime("sum over EndValue", bytes, [&] {
+    long long sum = 0;
+    for (auto v : terminated) sum += v;
+    return sum;
+  });
+  getScanTime("to_sized + sum", bytes, [&] {
+    long long sum = 0;
+    for (auto v : terminated | to_sized) sum += v;
+    return sum;
+  });
+
+  std::cout << '\n';
+
+  // the same 1 GB as 64 KB buffers that stay in the cache, where the
+  // scalar loop is no longer hidden behind the memory bandwidth
+  constexpr std::size_t small = (64 << 10) / sizeof(int);
+  constexpr std::size_t rounds = size / small;
+  std::ranges::subrange cached{values.end() - small, EndValue<-1>{}};
+
+  getScanTime("sum over EndValue, 64 KB", bytes, [&] {
+    long long sum = 0;
+    for (std::size_t r = 0; r < rounds; ++r) {
+      for (auto v : cached) sum += v;
+    }
+    return sum;
+  });
+  getScanTime("to_sized + sum, 64 KB", bytes, [&] {
+    long long sum = 0;
+    for (std::size_t r = 0; r < rounds; ++r) {
+      for (auto v : cached | to_sized) sum += v;
+    }
+    return sum;
+  });
+
+  return 0;
+}
@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <ranges>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+void print(const std::ranges::input_range auto& coll) {
+  for (const auto& elem : coll) {
+    std::cout << elem << ' ';
+  }
+  std::cout << '\n';
+}
+
+// Pipelines of filter, transform and take that run as one loop: the
+// terminal pushes every source element through all stages at once instead
+// of pulling it through a stack of view iterators. Running the stages a
+// block at a time, filtering into a buffer and transforming the buffer,
+// was slower for the pipelines below: the filter has to copy the kept
+// elements out, and the transforms do not vectorise anyway.
+namespace fused {
+
+template <typename Pred>
+struct Filter {
+  Pred pred;
+};
+
+template <typename Func>
+struct Transform {
+  Func func;
+};
+
+struct Take {
+  std::size_t count;
+};
+
+template <typename Stage>
+constexpr bool isFilter = false;
+template <typename Pred>
+constexpr bool isFilter<Filter<Pred>> = true;
+
+template <typename Stage>
+constexpr bool isTake = std::is_same_v<Stage, Take>;
+
+template <typename... Stages>
+class Pipeline {
+ public:
+  explicit Pipeline(std::tuple<Stages...> stages)
+      : stages{std::move(stages)} {}
+
+  std::tuple<Stages...> stages;
+
+  // Stages before the first filter map one element to one element, so a
+  // take among them only limits the source. A take behind a filter
+  // depends on the elements before it and is counted while running.
+  static constexpr std::size_t prefixEnd = [] {
+    constexpr bool filters[]{isFilter<Stages>..., true};
+    return static_cast<std::size_t>(std::ranges::find(filters, true) -
+                                    filters);
+  }();
+
+  static constexpr bool hasDynamicTake = [] {
+    constexpr bool takes[]{isTake<Stages>..., false};
+    return std::any_of(takes + prefixEnd, std::end(takes),
+                       [](bool take) { return take; });
+  }();
+
+  // number of source elements the pipeline consumes at most
+  std::size_t limit(std::size_t size) const {
+    limitFrom<0>(size);
+    return size;
+  }
+
+  // Runs value through the stages and hands the result to sink. Returns
+  // false once a take behind a filter is exhausted.
+  template <typename Value, typename Sink>
+  bool push(Value&& value, Sink& sink) {
+    return pushFrom<0>(std::forward<Value>(value), sink);
+  }
+
+  template <typename... Rhs>
+  friend Pipeline<Stages..., Rhs...> operator|(Pipeline lhs,
+                                               Pipeline<Rhs...> rhs) {
+    return Pipeline<Stages..., Rhs...>{
+        std::tuple_cat(std::move(lhs.stages), std::move(rhs.stages))};
+  }
+
+ private:
+  template <std::size_t I>
+  void limitFrom(std::size_t& size) const {
+    if constexpr (I < prefixEnd) {
+      if constexpr (isTake<std::tuple_element_t<I, decltype(stages)>>) {
+        size = std::min(size, std::get<I>(stages).count);
+      }
+      limitFrom<I + 1>(size);
+    }
+  }
+
+  template <std::size_t I, typename Value, typename Sink>
+  bool pushFrom(Value&& value, Sink& sink) {
+    if constexpr (I == sizeof...(Stages)) {
+      sink(std::forward<Value>(value));
+      return true;
+    } else {
+      auto& stage = std::get<I>(stages);
+      using Stage = std::remove_cvref_t<decltype(stage)>;
+      if constexpr (isFilter<Stage>) {
+        if (!std::invoke(stage.pred, std::as_const(value))) return true;
+        return pushFrom<I + 1>(std::forward<Value>(value), sink);
+      } else if constexpr (isTake<Stage>) {
+        if constexpr (I < prefixEnd) {
+          return pushFrom<I + 1>(std::forward<Value>(value), sink);
+        } else {
+          if (stage.count == 0) return false;
+          --stage.count;
+          const bool more =
+              pushFrom<I + 1>(std::forward<Value>(value), sink);
+          return more && stage.count != 0;
+        }
+      } else {
+        return pushFrom<I + 1>(
+            std::invoke(stage.func, std::forward<Value>(value)), sink);
+      }
+    }
+  }
+};
+
+template <typename Pred>
+Pipeline<Filter<Pred>> filter(Pred pred) {
+  return Pipeline<Filter<Pred>>{{Filter<Pred>{std::move(pred)}}};
+}
+
+template <typename Func>
+Pipeline<Transform<Func>> transform(Func func) {
+  return Pipeline<Transform<Func>>{{Transform<Func>{std::move(func)}}};
+}
+
+inline Pipeline<Take> take(std::size_t count) {
+  return Pipeline<Take>{{Take{count}}};
+}
+
+// A source with the stages applied to it, waiting for a terminal
+template <std::ranges::view Source, typename... Stages>
+struct Bound {
+  Source source;
+  Pipeline<Stages...> pipeline;
+
+  template <typename... Rhs>
+  friend Bound<Source, Stages..., Rhs...> operator|(Bound lhs,
+                                                    Pipeline<Rhs...> rhs) {
+    return {std::move(lhs.source), std::move(lhs.pipeline) | std::move(rhs)};
+  }
+};
+
+template <std::ranges::viewable_range Range, typename... Stages>
+Bound<std::views::all_t<Range>, Stages...> operator|(
+    Range&& rg, Pipeline<Stages...> pipeline) {
+  return {std::views::all(std::forward<Range>(rg)), std::move(pipeline)};
+}
+
+// Sequential run: a counted loop over a random access source, which has
+// no end test beyond the count when no take has to stop it early
+template <typename Source, typename... Stages, typename Sink>
+void run(Source& source, Pipeline<Stages...> pipeline, Sink& sink) {
+  using Pipe = Pipeline<Stages...>;
+  if constexpr (std::ranges::random_access_range<Source> &&
+                std::ranges::sized_range<Source>) {
+    const auto first = std::ranges::begin(source);
+    const auto count = pipeline.limit(std::ranges::size(source));
+    for (std::size_t i = 0; i < count; ++i) {
+      if constexpr (Pipe::hasDynamicTake) {
+        if (!pipeline.push(first[i], sink)) return;
+      } else {
+        pipeline.push(first[i], sink);
+      }
+    }
+  } else {
+    auto count = pipeline.limit(std::numeric_limits<std::size_t>::max());
+    for (auto&& value : source) {
+      if (count-- == 0) return;
+      if (!pipeline.push(std::forward<decltype(value)>(value), sink)) return;
+    }
+  }
+}
+
+template <typename Buffer>
+struct CollectInto {
+  Buffer* buffer;
+};
+
+// Replaces the contents of buffer with the results; the capacity of the
+// previous run is reused, so a warm buffer does not allocate
+template <typename Buffer>
+CollectInto<Buffer> collect_into(Buffer& buffer) {
+  return {&buffer};
+}
+
+template <typename Source, typename... Stages, typename Buffer>
+Buffer& operator|(Bound<Source, Stages...> bound, CollectInto<Buffer> into) {
+  auto& buffer = *into.buffer;
+  buffer.clear();
+  auto sink = [&buffer](auto&& value) {
+    buffer.push_back(std::forward<decltype(value)>(value));
+  };
+  run(bound.source, std::move(bound.pipeline), sink);
+  return buffer;
+}
+
+template <typename T, typename Op>
+struct ParReduce {
+  T init;
+  Op op;
+  unsigned numberThreads;
+};
+
+// Folds the results with op starting from init, which has to be an
+// identity of op. A random access source is split into chunks of a fixed
+// size that run on numberThreads threads, and the chunk results are
+// combined in a fixed order, so the result does not depend on the number
+// of threads.
+template <typename T, typename Op>
+ParReduce<T, Op> par_reduce(
+    T init, Op op,
+    unsigned numberThreads = std::max(1u,
+                                      std::thread::hardware_concurrency())) {
+  return {std::move(init), std::move(op), numberThreads};
+}
+
+template <typename Source, typename... Stages, typename T, typename Op>
+  requires std::ranges::random_access_range<Source> &&
+           std::ranges::sized_range<Source>
+T operator|(Bound<Source, Stages...> bound, ParReduce<T, Op> reduce) {
+  static_assert(!Pipeline<Stages...>::hasDynamicTake,
+                "a take behind a filter cannot be split across threads");
+  constexpr std::size_t chunkSize = 1 << 16;
+
+  const auto first = std::ranges::begin(bound.source);
+  const auto size = bound.pipeline.limit(std::ranges::size(bound.source));
+  if (size == 0) return reduce.init;
+  const auto chunks = (size + chunkSize - 1) / chunkSize;
+  std::vector<T> partials(chunks, reduce.init);
+
+  auto runChunk = [&](std::size_t chunk) {
+    T local = reduce.init;
+    auto sink = [&](auto&& value) {
+      local = reduce.op(std::move(local), std::forward<decltype(value)>(value));
+    };
+    auto pipeline = bound.pipeline;
+    const auto end = std::min(size, (chunk + 1) * chunkSize);
+    for (auto i = chunk * chunkSize; i < end; ++i) {
+      pipeline.push(first[i], sink);
+    }
+    partials[chunk] = std::move(local);
+  };
+
+  std::atomic<std::size_t> nextChunk{0};
+  auto work = [&] {
+    for (auto chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+      runChunk(chunk);
+    }
+  };
+  {
+    const auto numberThreads =
+        std::min<std::size_t>(std::max(reduce.numberThreads, 1u), chunks);
+    std::vector<std::jthread> workers;
+    for (std::size_t t = 1; t < numberThreads; ++t) workers.emplace_back(work);
+    work();
+  }
+
+  for (std::size_t stride = 1; stride < chunks; stride *= 2) {
+    for (std::size_t i = 0; i + stride < chunks; i += 2 * stride) {
+      partials[i] =
+          reduce.op(std::move(partials[i]), std::move(partials[i + stride]));
+    }
+  }
+  return std::move(partials.front());
+}
+
+}  // namespace fused
+
+template <typename Func>
+void getExecutionTime(const std::string& title, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  const auto result = func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec. (" << result << ")\n";
+}
+
+int main() {
+  std::vector<int> col1{0, 8, 15, 47, 11, 42};
+  std::set<int> col2{0, 8, 15, 47, 11, 42};
+
+  auto suffix = [](auto v) { return std::to_string(v) + 's'; };
+
+  std::vector<std::string> buffer;
+  print(col1 | fused::take(3) | fused::transform(suffix) |
+        fused::collect_into(buffer));
+  print(col2 | fused::take(3) | fused::transform(suffix) |
+        fused::collect_into(buffer));
+  std::vector<int> odd;
+  print(col1 | fused::filter([](int v) { return v % 2 == 1; }) |
+        fused::take(2) | fused::collect_into(odd));
+  std::cout << (col1 | fused::transform([](int v) { return v * v; }) |
+                fused::par_reduce(0, std::plus{}))
+            << '\n';
+
+  std::cout << '\n';
+
+  constexpr std::size_t size = 100'000'000;
+  std::vector<int> values(size);
+  std::iota(values.begin(), values.end(), 0);
+
+  auto isEven = [](int v) { return v % 2 == 0; };
+  auto square = [](int v) { return static_cast<long long>(v) * v % 1000; };
+
+  getExecutionTime("views::filter | views::transform, loop", [&] {
+    long long sum = 0;
+    for (auto v : values | std::views::filter(isEven) |
+                      std::views::transform(square)) {
+      sum += v;
+    }
+    return sum;
+  });
+  auto sumOfSquares = [&](unsigned numberThreads) {
+    return values | fused::filter(isEven) | fused::transform(square) |
+           fused::par_reduce(0LL, std::plus{}, numberThreads);
+  };
+  getExecutionTime("fused par_reduce, 1 thread",
+                   [&] { return sumOfSquares(1); });
+  getExecutionTime(
+      "fused par_reduce, " +
+          std::to_string(std::thread::hardware_concurrency()) + " threads",
+      [&] { return sumOfSquares(std::thread::hardware_concurrency()); });
+
+  std::cout << '\n';
+
+  constexpr std::size_t count = size / 10;
+  getExecutionTime("views::take | views::transform, push_back", [&] {
+    std::vector<std::string> strings;
+    for (auto&& s :
+         values | std::views::take(count) | std::views::transform(suffix)) {
+      strings.push_back(std::move(s));
+    }
+    return strings.size();
+  });
+  std::vector<std::string> strings;
+  auto collectStrings = [&] {
+    return (values | fused::take(count) | fused::transform(suffix) |
+            fused::collect_into(strings))
+        .size();
+  };
+  collectStrings();
+  getExecutionTime("fused collect_into, warm buffer", collectStrings);
+
+  return 0;
+}
@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Sorts the elements behind oldSize and merges them with the sorted
+// elements before it, dropping duplicates. The old elements come first
+// and the merge is stable, so like for std::set an insert does not
+// replace an equal element that is already there.
+template <typename Vector, typename Less>
+void mergeSortedTail(Vector& vec, std::size_t oldSize, Less less) {
+  const auto middle = vec.begin() + static_cast<std::ptrdiff_t>(oldSize);
+  std::stable_sort(middle, vec.end(), less);
+  std::inplace_merge(vec.begin(), middle, vec.end(), less);
+  const auto last =
+      std::unique(vec.begin(), vec.end(),
+                  [&less](const auto& lhs, const auto& rhs) {
+                    return !less(lhs, rhs);
+                  });
+  vec.erase(last, vec.end());
+}
+
+// Sorted unique keys in one vector: lookups are binary searches over
+// contiguous memory and iteration is a linear scan. A single insert moves
+// the tail, so many keys should go in with insert_range, which sorts the
+// new keys once and merges them with the old ones.
+template <typename Key, typename Compare = std::less<Key>>
+class flat_set {
+ public:
+  using key_type = Key;
+  using value_type = Key;
+  using size_type = std::size_t;
+  using iterator = typename std::vector<Key>::const_iterator;
+  using const_iterator = iterator;
+
+  flat_set() = default;
+
+  template <std::ranges::input_range Range>
+  explicit flat_set(Range&& rg) {
+    insert_range(std::forward<Range>(rg));
+  }
+
+  iterator begin() const { return keys.begin(); }
+  iterator end() const { return keys.end(); }
+  size_type size() const { return keys.size(); }
+  bool empty() const { return keys.empty(); }
+  void clear() { keys.clear(); }
+  void reserve(size_type count) { keys.reserve(count); }
+
+  iterator lower_bound(const Key& key) const {
+    return std::lower_bound(keys.begin(), keys.end(), key, comp);
+  }
+
+  iterator find(const Key& key) const {
+    const auto pos = lower_bound(key);
+    return pos != keys.end() && !comp(key, *pos) ? pos : keys.end();
+  }
+
+  bool contains(const Key& key) const { return find(key) != keys.end(); }
+
+  template <typename K>
+    requires std::constructible_from<Key, K>
+  std::pair<iterator, bool> insert(K&& key) {
+    const auto pos = lower_bound(key);
+    if (pos != keys.end() && !comp(key, *pos)) {
+      return {pos, false};
+    }
+    return {keys.emplace(pos, std::forward<K>(key)), true};
+  }
+
+  template <std::ranges::input_range Range>
+  void insert_range(Range&& rg) {
+    const auto oldSize = keys.size();
+    if constexpr (std::ranges::sized_range<Range>) {
+      keys.reserve(oldSize + std::ranges::size(rg));
+    }
+    for (auto&& key : rg) keys.emplace_back(std::forward<decltype(key)>(key));
+    mergeSortedTail(keys, oldSize, comp);
+  }
+
+  size_type erase(const Key& key) {
+    const auto pos = find(key);
+    if (pos == keys.end()) return 0;
+    keys.erase(pos);
+    return 1;
+  }
+
+ private:
+  std::vector<Key> keys;
+  [[no_unique_address]] Compare comp;
+};
+
+// Key value pairs sorted by key in one vector. The iterators give access
+// to the whole pair, like those of a vector: changing a key through them
+// breaks the order of the map.
+template <typename Key, typename T, typename Compare = std::less<Key>>
+class flat_map {
+ public:
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<Key, T>;
+  using size_type = std::size_t;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  flat_map() = default;
+
+  template <std::ranges::input_range Range>
+  explicit flat_map(Range&& rg) {
+    insert_range(std::forward<Range>(rg));
+  }
+
+  iterator begin() { return elements.begin(); }
+  iterator end() { return elements.end(); }
+  const_iterator begin() const { return elements.begin(); }
+  const_iterator end() const { return elements.end(); }
+  size_type size() const { return elements.size(); }
+  bool empty() const { return elements.empty(); }
+  void clear() { elements.clear(); }
+  void reserve(size_type count) { elements.reserve(count); }
+
+  iterator lower_bound(const Key& key) {
+    return std::lower_bound(elements.begin(), elements.end(), key, keyLess());
+  }
+  const_iterator lower_bound(const Key& key) const {
+    return std::lower_bound(elements.begin(), elements.end(), key, keyLess());
+  }
+
+  iterator find(const Key& key) {
+    const auto pos = lower_bound(key);
+    return pos != end() && !comp(key, pos->first) ? pos : end();
+  }
+  const_iterator find(const Key& key) const {
+    const auto pos = lower_bound(key);
+    return pos != end() && !comp(key, pos->first) ? pos : end();
+  }
+
+  bool contains(const Key& key) const { return find(key) != end(); }
+
+  T& at(const Key& key) {
+    const auto pos = find(key);
+    if (pos == end()) throw std::out_of_range("flat_map::at");
+    return pos->second;
+  }
+
+  T& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+    const auto pos = lower_bound(key);
+    if (pos != end() && !comp(key, pos->first)) {
+      return {pos, false};
+    }
+    return {elements.emplace(pos, std::piecewise_construct,
+                             std::forward_as_tuple(key),
+                             std::forward_as_tuple(
+                                 std::forward<Args>(args)...)),
+            true};
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return try_emplace(value.first, value.second);
+  }
+
+  template <std::ranges::input_range Range>
+  void insert_range(Range&& rg) {
+    const auto oldSize = elements.size();
+    if constexpr (std::ranges::sized_range<Range>) {
+      elements.reserve(oldSize + std::ranges::size(rg));
+    }
+    for (auto&& element : rg) {
+      elements.emplace_back(std::forward<decltype(element)>(element));
+    }
+    mergeSortedTail(elements, oldSize, pairLess());
+  }
+
+  size_type erase(const Key& key) {
+    const auto pos = find(key);
+    if (pos == end()) return 0;
+    elements.erase(pos);
+    return 1;
+  }
+
+ private:
+  auto keyLess() const {
+    return [this](const value_type& element, const Key& key) {
+      return comp(element.first, key);
+    };
+  }
+
+  auto pairLess() const {
+    return [this](const value_type& lhs, const value_type& rhs) {
+      return comp(lhs.first, rhs.first);
+    };
+  }
+
+  std::vector<value_type> elements;
+  [[no_unique_address]] Compare comp;
+};
+
+// add() from 30_sort
+template <std::ranges::range Coll, typename T>
+void add(Coll& col, const T& val) requires
+    std::convertible_to<T, std::ranges::range_value_t<Coll>> {
+  if constexpr (requires { col.push_back(val); }) {
+    col.push_back(val);
+  } else {
+    col.insert(val);
+  }
+}
+
+// Adds many values at once: appended to sequences, merged in one step into
+// collections with insert_range, one by one into the others
+template <std::ranges::range Coll, std::ranges::input_range Range>
+void add_range(Coll& col, Range&& rg) requires std::convertible_to<
+    std::ranges::range_reference_t<Range>, std::ranges::range_value_t<Coll>> {
+  if constexpr (requires { col.push_back(*std::ranges::begin(rg)); }) {
+    if constexpr (std::ranges::common_range<Range>) {
+      col.insert(col.end(), std::ranges::begin(rg), std::ranges::end(rg));
+    } else {
+      std::ranges::copy(rg, std::back_inserter(col));
+    }
+  } else if constexpr (requires { col.insert_range(rg); }) {
+    col.insert_range(std::forward<Range>(rg));
+  } else {
+    for (auto&& val : rg) col.insert(std::forward<decltype(val)>(val));
+  }
+}
+
+template <typename Func>
+double getSeconds(Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  return dur.count();
+}
+
+template <typename T>
+void benchmark(const std::string& title, const std::vector<T>& values,
+               const std::vector<T>& queries) {
+  std::vector<std::size_t> found;
+  std::vector<std::size_t> visited;
+
+  auto measure = [&](auto& col, auto fill) {
+    found.push_back(0);
+    visited.push_back(0);
+    const auto insert = getSeconds([&] { fill(col); });
+    const auto lookup = getSeconds([&] {
+      for (const auto& query : queries) found.back() += col.contains(query);
+    });
+    const auto iterate = getSeconds([&] {
+      for (const auto& elem : col) {
+        if constexpr (std::integral<T>) {
+          visited.back() += static_cast<std::size_t>(elem);
+        } else {
+          visited.back() += elem.size();
+        }
+      }
+    });
+    std::cout << " insert " << insert << " lookup " << lookup << " iterate "
+              << iterate << '\n';
+  };
+
+  std::cout << title << ", " << values.size() << " elements\n";
+
+  std::set<T> set;
+  std::cout << "  std::set, add:            ";
+  measure(set, [&](auto& col) {
+    for (const auto& value : values) add(col, value);
+  });
+
+  if (values.size() <= 100'000) {
+    flat_set<T> flatOneByOne;
+    std::cout << "  flat_set, add:            ";
+    measure(flatOneByOne, [&](auto& col) {
+      for (const auto& value : values) add(col, value);
+    });
+  }
+
+  flat_set<T> flat;
+  std::cout << "  flat_set, add_range:      ";
+  measure(flat, [&](auto& col) { add_range(col, values); });
+
+  if (!std::ranges::equal(set, flat)) std::cout << "Different contents\n";
+  if (std::ranges::adjacent_find(found, std::not_equal_to{}) != found.end() ||
+      std::ranges::adjacent_find(visited, std::not_equal_to{}) !=
+          visited.end()) {
+    std::cout << "Different lookup or iteration results\n";
+  }
+}
+
+int main() {
+  std::vector<int> col1;
+  std::set<int> col2;
+  flat_set<int> col3;
+
+  add(col1, 42);
+  add(col2, 42);
+  add(col3, 42);
+  add_range(col1, std::vector{7, 1, 42});
+  add_range(col2, std::vector{7, 1, 42});
+  add_range(col3, std::vector{7, 1, 42});
+  // a range whose sentinel type differs from its iterator type
+  add_range(col1, std::views::iota(100) |
+                      std::views::take_while([](int v) { return v < 103; }));
+
+  for (const auto& i : col1) {
+    std::cout << i << ' ';
+  }
+  for (const auto& i : col2) {
+    std::cout << i << ' ';
+  }
+  for (const auto& i : col3) {
+    std::cout << i << ' ';
+  }
+  std::cout << '\n';
+
+  flat_map<std::string, int> ages;
+  ages.insert_range(std::vector<std::pair<std::string, int>>{
+      {"Tom", 42}, {"Ann", 37}, {"Tom", 11}});
+  ages["Bob"] = 25;
+  for (const auto& [name, age] : ages) {
+    std::cout << name << ": " << age << ' ';
+  }
+  std::cout << "\n\n";
+
+  std::mt19937 engine;
+  for (std::size_t size : {1'000, 100'000, 10'000'000}) {
+    std::uniform_int_distribution<int> dist(0, static_cast<int>(2 * size));
+    std::vector<int> values(size);
+    for (auto& value : values) value = dist(engine);
+    std::vector<int> queries(1'000'000);
+    for (auto& query : queries) query = dist(engine);
+    benchmark("int", values, queries);
+  }
+
+  for (std::size_t size : {1'000, 100'000, 1'000'000, 10'000'000}) {
+    std::uniform_int_distribution<int> dist(0, static_cast<int>(2 * size));
+    auto randomString = [&] { return "key-" + std::to_string(dist(engine)); };
+    std::vector<std::string> values(size);
+    for (auto& value : values) value = randomString();
+    std::vector<std::string> queries(1'000'000);
+    for (auto& query : queries) query = randomString();
+    benchmark("std::string", values, queries);
+  }
+
+  return 0;
+}
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <vector>
+
+// mergeValue() from 13_auto_parameters
+auto mergeValue(const auto& rg, auto&&... vals) {
+  using T = std::remove_cvref_t<decltype(rg)>::value_type;
+  std::vector<T> v{rg.begin(), rg.end()};
+
+  (...,
+   v.push_back(std::forward<decltype(vals)>(vals)));  // merge passed values
+
+  std::ranges::sort(v);  // sort all elements
+
+  // return extended collection
+  return v;
+}
+
+// First element of the sorted range [first, last) greater than value,
+// searched from the back in growing steps: close to the end it costs a
+// few compares, far from it a logarithmic number
+template <typename It, typename T, typename Compare>
+It gallopUpperBound(It first, It last, const T& value, Compare comp) {
+  std::ptrdiff_t step = 1;
+  while (last - first > step && comp(value, *(last - step))) {
+    last -= step;
+    step *= 2;
+  }
+  return std::upper_bound(last - first > step ? last - step : first, last,
+                          value, comp);
+}
+
+// The values to merge as a vector; a range whose end is a sentinel has no
+// iterator pair for the vector constructor
+template <typename T, std::ranges::input_range Range>
+std::vector<T> toVector(Range&& values) {
+  if constexpr (std::ranges::common_range<Range>) {
+    return std::vector<T>(std::ranges::begin(values), std::ranges::end(values));
+  } else {
+    std::vector<T> result;
+    std::ranges::copy(values, std::back_inserter(result));
+    return result;
+  }
+}
+
+// Merges values into the sorted vector. Only the new values are sorted,
+// then both runs are merged from the back into the grown vector: the old
+// elements behind each new value are found by galloping and moved as one
+// block, and the elements in front of the smallest new value do not move.
+// With enough capacity the vector does not reallocate. Values equal to an
+// old element go behind it.
+template <std::default_initializable T, std::ranges::input_range Range,
+          typename Compare = std::ranges::less>
+void merge_into(std::vector<T>& sorted, Range&& values, Compare comp = {}) {
+  auto added = toVector<T>(std::forward<Range>(values));
+  std::ranges::sort(added, comp);
+
+  const auto oldSize = sorted.size();
+  sorted.resize(oldSize + added.size());
+  auto oldEnd = sorted.begin() + static_cast<std::ptrdiff_t>(oldSize);
+  auto out = sorted.end();
+  for (auto pos = added.end(); pos != added.begin();) {
+    --pos;
+    const auto greater = gallopUpperBound(sorted.begin(), oldEnd, *pos, comp);
+    out = std::move_backward(greater, oldEnd, out);
+    oldEnd = greater;
+    *--out = std::move(*pos);
+  }
+}
+
+// Merge path: the merged sequence is cut into equal slices, and a binary
+// search along the diagonal of every cut finds how many elements of each
+// input come before it. The slices are then merged independently into the
+// scratch vector, which is swapped with sorted afterwards, so the old
+// storage is reused as scratch space by the next call.
+template <std::default_initializable T, std::ranges::input_range Range,
+          typename Compare = std::ranges::less>
+void parallel_merge_into(
+    std::vector<T>& sorted, Range&& values, std::vector<T>& scratch,
+    unsigned numberThreads = std::max(1u, std::thread::hardware_concurrency()),
+    Compare comp = {}) {
+  auto added = toVector<T>(std::forward<Range>(values));
+  std::ranges::sort(added, comp);
+
+  const auto n = sorted.size();
+  const auto k = added.size();
+  scratch.resize(n + k);
+
+  // number of old elements among the first diag merged elements
+  auto split = [&](std::size_t diag) {
+    auto lo = diag > k ? diag - k : 0;
+    auto hi = std::min(diag, n);
+    while (lo < hi) {
+      const auto mid = lo + (hi - lo) / 2;
+      if (!comp(added[diag - mid - 1], sorted[mid])) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  };
+
+  const auto total = n + k;
+  numberThreads = static_cast<unsigned>(std::clamp<std::size_t>(
+      numberThreads, 1, std::max<std::size_t>(total, 1)));
+  auto mergeSlice = [&](unsigned slice) {
+    const auto first = total * slice / numberThreads;
+    const auto last = total * (slice + 1) / numberThreads;
+    const auto i0 = split(first);
+    const auto i1 = split(last);
+    std::merge(std::make_move_iterator(sorted.begin() + i0),
+               std::make_move_iterator(sorted.begin() + i1),
+               std::make_move_iterator(added.begin() + (first - i0)),
+               std::make_move_iterator(added.begin() + (last - i1)),
+               scratch.begin() + first, comp);
+  };
+  {
+    std::vector<std::jthread> workers;
+    for (unsigned slice = 1; slice < numberThreads; ++slice) {
+      workers.emplace_back(mergeSlice, slice);
+    }
+    mergeSlice(0);
+  }
+  sorted.swap(scratch);
+}
+
+template <typename Func>
+void getExecutionTime(const std::string& title, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << "  " << title << ": " << dur.count() << " sec.\n";
+}
+
+int main() {
+  constexpr std::array orig{0, 8, 15, 132, 4, 77, 3};
+
+  auto merged = mergeValue(orig, 42, 4);
+  for (const auto& i : merged) {
+    std::cout << i << ' ';
+  }
+  std::cout << '\n';
+
+  std::vector<int> sorted{orig.begin(), orig.end()};
+  std::ranges::sort(sorted);
+  merge_into(sorted, std::array{42, 4});
+  merge_into(sorted, std::views::iota(5) | std::views::take(3));
+  for (const auto& i : sorted) {
+    std::cout << i << ' ';
+  }
+  std::cout << "\n\n";
+
+  constexpr std::size_t size = 10'000'000;
+  std::mt19937 engine;
+  std::uniform_int_distribution<int> dist;
+  std::vector<int> base(size);
+  for (auto& value : base) value = dist(engine);
+  std::ranges::sort(base);
+
+  for (std::size_t k : {1, 10, 100, 1'000, 10'000, 100'000, 1'000'000}) {
+    std::vector<int> values(k);
+    for (auto& value : values) value = dist(engine);
+    std::cout << "n = " << size << ", k = " << k << '\n';
+
+    auto resorted = base;
+    resorted.reserve(size + k);
+    getExecutionTime("append + std::ranges::sort", [&] {
+      resorted.insert(resorted.end(), values.begin(), values.end());
+      std::ranges::sort(resorted);
+    });
+
+    auto inPlace = base;
+    inPlace.reserve(size + k);
+    getExecutionTime("merge_into", [&] { merge_into(inPlace, values); });
+
+    auto parallel = base;
+    std::vector<int> scratch;
+    scratch.reserve(size + k);
+    getExecutionTime(
+        "parallel_merge_into, " +
+            std::to_string(std::thread::hardware_concurrency()) + " threads",
+        [&] { parallel_merge_into(parallel, values, scratch); });
+
+    if (inPlace != resorted || parallel != resorted) {
+      std::cout << "Wrong merge result\n";
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,603 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Keeps freed blocks of one size in a per-thread free list, so creating a
+// shared state is a pointer pop instead of a call to operator new.
+template <std::size_t Size>
+class BlockPool {
+ public:
+  static void* allocate() {
+    auto& list = freeList();
+    if (list.head == nullptr) {
+      return ::operator new(Size);
+    }
+    auto* block = list.head;
+    list.head = block->next;
+    --list.count;
+    return block;
+  }
+
+  static void deallocate(void* ptr) {
+    auto& list = freeList();
+    if (list.count == maxCached) {
+      ::operator delete(ptr);
+      return;
+    }
+    list.head = ::new (ptr) Block{list.head};
+    ++list.count;
+  }
+
+ private:
+  static_assert(Size >= sizeof(void*));
+  static constexpr std::size_t maxCached = 4096;
+
+  struct Block {
+    Block* next;
+  };
+
+  struct FreeList {
+    Block* head = nullptr;
+    std::size_t count = 0;
+
+    ~FreeList() {
+      while (head != nullptr) {
+        ::operator delete(std::exchange(head, head->next));
+      }
+    }
+  };
+
+  static FreeList& freeList() {
+    thread_local FreeList list;
+    return list;
+  }
+};
+
+template <typename T>
+using Stored = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+// State shared by one fast_promise and one fast_future. The atomic state
+// goes Empty -> Waiting (a thread blocks in get) or Empty -> Continuation
+// (then or co_await registered a callback) and finally to Ready; only the
+// producer moves to Ready, so no mutex is needed.
+template <typename T>
+class SharedState {
+ public:
+  static void* operator new(std::size_t size) {
+    assert(size == sizeof(SharedState));
+    return BlockPool<sizeof(SharedState)>::allocate();
+  }
+  static void operator delete(void* ptr) {
+    BlockPool<sizeof(SharedState)>::deallocate(ptr);
+  }
+
+  void addRef() { refs.fetch_add(1, std::memory_order_relaxed); }
+  void release() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  template <typename... Args>
+  void setValue(Args&&... args) {
+    result.template emplace<1>(std::forward<Args>(args)...);
+    publish();
+  }
+
+  void setException(std::exception_ptr error) {
+    result.template emplace<2>(std::move(error));
+    publish();
+  }
+
+  bool isReady() const {
+    return state.load(std::memory_order_acquire) == Ready;
+  }
+
+  void wait() {
+    auto cur = state.load(std::memory_order_acquire);
+    if (cur == Empty) {
+      state.compare_exchange_strong(cur, Waiting, std::memory_order_acq_rel);
+    }
+    while ((cur = state.load(std::memory_order_acquire)) != Ready) {
+      state.wait(cur, std::memory_order_acquire);
+    }
+  }
+
+  Stored<T> take() {
+    wait();
+    if (result.index() == 2) {
+      std::rethrow_exception(std::get<2>(result));
+    }
+    return std::move(std::get<1>(result));
+  }
+
+  // Stores the callback; returns false if the result is already there, in
+  // which case the caller runs or drops the stored callback itself.
+  template <typename F>
+  bool setContinuation(F&& func) {
+    using Fn = std::decay_t<F>;
+    if constexpr (sizeof(Fn) <= sizeof(storage) &&
+                  alignof(Fn) <= alignof(std::max_align_t)) {
+      ::new (static_cast<void*>(storage)) Fn(std::forward<F>(func));
+      // move the callback out first: running it may drop the last
+      // reference and free this state
+      invoke = [](void* stored, bool run) {
+        Fn fn{std::move(*static_cast<Fn*>(stored))};
+        static_cast<Fn*>(stored)->~Fn();
+        if (run) fn();
+      };
+    } else {
+      return setContinuation(
+          [fn = std::make_unique<Fn>(std::forward<F>(func))] { (*fn)(); });
+    }
+    std::uint8_t expected = Empty;
+    return state.compare_exchange_strong(expected, Continuation,
+                                         std::memory_order_acq_rel);
+  }
+
+  void runContinuation() { invoke(storage, true); }
+  void dropContinuation() { invoke(storage, false); }
+
+ private:
+  enum : std::uint8_t { Empty, Waiting, Continuation, Ready };
+
+  void publish() {
+    switch (state.exchange(Ready, std::memory_order_acq_rel)) {
+      case Waiting:
+        state.notify_all();
+        break;
+      case Continuation:
+        runContinuation();
+        break;
+    }
+  }
+
+  std::atomic<std::uint8_t> state{Empty};
+  std::atomic<std::uint32_t> refs{1};
+  std::variant<std::monostate, Stored<T>, std::exception_ptr> result;
+  void (*invoke)(void*, bool) = nullptr;
+  alignas(std::max_align_t) std::byte storage[64];
+};
+
+template <typename T>
+class fast_future;
+
+template <typename T>
+class fast_promise {
+ public:
+  fast_promise() : state{new SharedState<T>} {}
+  fast_promise(fast_promise&& other) noexcept
+      : state{std::exchange(other.state, nullptr)},
+        satisfied{other.satisfied} {}
+  fast_promise& operator=(fast_promise&& other) noexcept {
+    fast_promise{std::move(other)}.swap(*this);
+    return *this;
+  }
+  ~fast_promise() {
+    if (state == nullptr) return;
+    if (!satisfied) {
+      state->setException(std::make_exception_ptr(
+          std::future_error(std::future_errc::broken_promise)));
+    }
+    state->release();
+  }
+
+  void swap(fast_promise& other) noexcept {
+    std::swap(state, other.state);
+    std::swap(satisfied, other.satisfied);
+  }
+
+  fast_future<T> get_future() {
+    state->addRef();
+    return fast_future<T>{state};
+  }
+
+  // satisfied only once the result is stored: if constructing the value
+  // throws, the destructor still breaks the promise
+  template <typename... Args>
+  void set_value(Args&&... args) {
+    state->setValue(std::forward<Args>(args)...);
+    satisfied = true;
+  }
+
+  void set_exception(std::exception_ptr error) {
+    state->setException(std::move(error));
+    satisfied = true;
+  }
+
+ private:
+  SharedState<T>* state;
+  bool satisfied = false;
+};
+
+// Anything that can run a task later, e.g. on a thread pool
+template <typename E>
+concept Executor = requires(E& executor, std::function<void()> task) {
+  executor.execute(std::move(task));
+};
+
+template <typename T, typename F>
+using ThenResult = std::conditional_t<std::is_void_v<T>, std::invoke_result<F>,
+                                      std::invoke_result<F, T>>::type;
+
+template <typename T>
+struct FuturePromiseBase {
+  fast_promise<T> result;
+
+  fast_future<T> get_return_object() { return result.get_future(); }
+  std::suspend_never initial_suspend() noexcept { return {}; }
+  std::suspend_never final_suspend() noexcept { return {}; }
+  void unhandled_exception() { result.set_exception(std::current_exception()); }
+};
+
+template <typename T>
+struct FuturePromise : FuturePromiseBase<T> {
+  template <typename U>
+  void return_value(U&& value) {
+    this->result.set_value(std::forward<U>(value));
+  }
+};
+
+template <>
+struct FuturePromise<void> : FuturePromiseBase<void> {
+  void return_void() { result.set_value(); }
+};
+
+template <typename T>
+class fast_future {
+ public:
+  // a coroutine returning fast_future<T> runs eagerly and fulfils it
+  using promise_type = FuturePromise<T>;
+
+  fast_future() = default;
+  fast_future(fast_future&& other) noexcept
+      : state{std::exchange(other.state, nullptr)} {}
+  fast_future& operator=(fast_future&& other) noexcept {
+    std::swap(state, other.state);
+    return *this;
+  }
+  ~fast_future() {
+    if (state != nullptr) state->release();
+  }
+
+  bool valid() const { return state != nullptr; }
+  bool is_ready() const { return state->isReady(); }
+  void wait() const { state->wait(); }
+
+  T get() {
+    std::unique_ptr<SharedState<T>, Release> owner{
+        std::exchange(state, nullptr)};
+    if constexpr (std::is_void_v<T>) {
+      owner->take();
+    } else {
+      return owner->take();
+    }
+  }
+
+  // Calls func with this (ready) future on the thread that fulfils the
+  // promise, or right here if that already happened.
+  template <std::invocable<fast_future&&> F>
+  void on_ready(F&& func) {
+    auto* shared = std::exchange(state, nullptr);
+    if (!shared->setContinuation([self = fast_future{shared},
+                                  func = std::forward<F>(func)]() mutable {
+          func(std::move(self));
+        })) {
+      shared->runContinuation();
+    }
+  }
+
+  // Calls func with the value once it is there; an exception skips func
+  // and ends up in the returned future.
+  template <typename F>
+  fast_future<ThenResult<T, F>> then(F&& func) {
+    fast_promise<ThenResult<T, F>> next;
+    auto future = next.get_future();
+    on_ready([func = std::forward<F>(func),
+              next = std::move(next)](fast_future self) mutable {
+      fulfil(next, [&] { return invokeWith(self, func); });
+    });
+    return future;
+  }
+
+  // Like then(func), but func runs as a task of the executor
+  template <Executor E, typename F>
+  fast_future<ThenResult<T, F>> then(E& executor, F&& func) {
+    fast_promise<ThenResult<T, F>> next;
+    auto future = next.get_future();
+    on_ready([&executor, func = std::forward<F>(func),
+              next = std::move(next)](fast_future self) mutable {
+      auto task = [self = std::move(self), func = std::move(func),
+                   next = std::move(next)]() mutable {
+        fulfil(next, [&] { return invokeWith(self, func); });
+      };
+      // std::function needs a copyable target
+      executor.execute(
+          [task = std::make_shared<decltype(task)>(std::move(task))] {
+            (*task)();
+          });
+    });
+    return future;
+  }
+
+  auto operator co_await() && {
+    struct Awaiter {
+      fast_future future;
+
+      bool await_ready() const { return future.is_ready(); }
+      bool await_suspend(std::coroutine_handle<> handle) {
+        if (future.state->setContinuation([handle] { handle.resume(); })) {
+          return true;
+        }
+        future.state->dropContinuation();
+        return false;
+      }
+      T await_resume() { return future.get(); }
+    };
+    return Awaiter{std::move(*this)};
+  }
+
+ private:
+  template <typename>
+  friend class fast_promise;
+
+  struct Release {
+    void operator()(SharedState<T>* shared) const { shared->release(); }
+  };
+
+  explicit fast_future(SharedState<T>* state) : state{state} {}
+
+  template <typename F>
+  static ThenResult<T, F> invokeWith(fast_future& self, F& func) {
+    if constexpr (std::is_void_v<T>) {
+      self.get();
+      return func();
+    } else {
+      return func(self.get());
+    }
+  }
+
+  template <typename U, typename Func>
+  static void fulfil(fast_promise<U>& promise, Func&& func) {
+    try {
+      if constexpr (std::is_void_v<U>) {
+        func();
+        promise.set_value();
+      } else {
+        promise.set_value(func());
+      }
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+
+  SharedState<T>* state = nullptr;
+};
+
+// Ready when all futures are; the first exception wins. All children share
+// one context holding the results and the countdown.
+template <typename T>
+fast_future<std::vector<T>> when_all(std::vector<fast_future<T>> futures) {
+  struct Context {
+    std::vector<T> values;
+    std::atomic<std::size_t> pending;
+    std::atomic<bool> failed{false};
+    fast_promise<std::vector<T>> promise;
+  };
+  auto context = std::make_shared<Context>();
+  context->values.resize(futures.size());
+  context->pending = futures.size();
+  auto result = context->promise.get_future();
+  if (futures.empty()) {
+    context->promise.set_value();
+  }
+  for (std::size_t i = 0; i < futures.size(); ++i) {
+    futures[i].on_ready([context, i](fast_future<T> future) {
+      try {
+        context->values[i] = future.get();
+      } catch (...) {
+        if (!context->failed.exchange(true, std::memory_order_acq_rel)) {
+          context->promise.set_exception(std::current_exception());
+        }
+      }
+      if (context->pending.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+          !context->failed.load(std::memory_order_acquire)) {
+        context->promise.set_value(std::move(context->values));
+      }
+    });
+  }
+  return result;
+}
+
+// Ready with the index and the result of the first future that is; fails
+// right away with std::invalid_argument if there are none
+template <typename T>
+fast_future<std::pair<std::size_t, T>> when_any(
+    std::vector<fast_future<T>> futures) {
+  struct Context {
+    std::atomic<bool> done{false};
+    fast_promise<std::pair<std::size_t, T>> promise;
+  };
+  auto context = std::make_shared<Context>();
+  auto result = context->promise.get_future();
+  if (futures.empty()) {
+    context->promise.set_exception(std::make_exception_ptr(
+        std::invalid_argument("when_any of no futures")));
+  }
+  for (std::size_t i = 0; i < futures.size(); ++i) {
+    futures[i].on_ready([context, i](fast_future<T> future) {
+      try {
+        auto value = future.get();
+        if (!context->done.exchange(true, std::memory_order_acq_rel)) {
+          context->promise.set_value(i, std::move(value));
+        }
+      } catch (...) {
+        if (!context->done.exchange(true, std::memory_order_acq_rel)) {
+          context->promise.set_exception(std::current_exception());
+        }
+      }
+    });
+  }
+  return result;
+}
+
+// Runs tasks on one worker thread
+class ThreadExecutor {
+ public:
+  ThreadExecutor()
+      : worker{[this](std::stop_token token) { run(token); }} {}
+
+  void execute(std::function<void()> task) {
+    {
+      std::lock_guard lock(tasksMutex);
+      tasks.push_back(std::move(task));
+    }
+    tasksCondition.notify_one();
+  }
+
+ private:
+  void run(std::stop_token token) {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock lock(tasksMutex);
+        if (!tasksCondition.wait(lock, token,
+                                 [this] { return !tasks.empty(); })) {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex tasksMutex;
+  std::condition_variable_any tasksCondition;
+  std::deque<std::function<void()>> tasks;
+  std::jthread worker;
+};
+
+fast_future<int> divide(int a, int b) {
+  fast_promise<int> divPromise;
+  auto divResult = divPromise.get_future();
+  std::thread([divPromise = std::move(divPromise), a, b]() mutable {
+    try {
+      if (b == 0) throw std::runtime_error("illegal division by zero");
+      divPromise.set_value(a / b);
+    } catch (...) {
+      divPromise.set_exception(std::current_exception());
+    }
+  }).detach();
+  return divResult;
+}
+
+fast_future<int> addQuotients() {
+  const int first = co_await divide(20, 10);
+  const int second = co_await divide(30, 10);
+  co_return first + second;
+}
+
+template <typename Func>
+void getExecutionTime(const std::string& title, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec. " << std::endl;
+}
+
+template <template <typename> typename Promise>
+long long createFulfilGet(int count) {
+  long long sum = 0;
+  for (int i = 0; i < count; ++i) {
+    Promise<int> promise;
+    auto future = promise.get_future();
+    promise.set_value(i);
+    sum += future.get();
+  }
+  return sum;
+}
+
+// a second thread fulfils the promises while this one waits for them
+template <template <typename> typename Promise>
+long long crossThread(int count) {
+  std::vector<Promise<int>> promises(count);
+  std::vector<decltype(promises.front().get_future())> futures;
+  futures.reserve(count);
+  for (auto& promise : promises) futures.push_back(promise.get_future());
+  std::jthread producer([&promises] {
+    for (int i = 0; auto& promise : promises) promise.set_value(i++);
+  });
+  long long sum = 0;
+  for (auto& future : futures) sum += future.get();
+  return sum;
+}
+
+int main() {
+  std::cout << '\n';
+
+  std::cout << "20/10 + 30/10 = " << addQuotients().get() << '\n';
+
+  try {
+    divide(20, 0).get();
+  } catch (const std::runtime_error& e) {
+    std::cout << e.what() << '\n';
+  }
+
+  ThreadExecutor executor;
+  auto chained = divide(20, 10)
+                     .then([](int quotient) { return quotient * 100; })
+                     .then(executor, [](int value) {
+                       return std::to_string(value) + " on the executor";
+                     });
+  std::cout << chained.get() << '\n';
+
+  std::vector<fast_future<int>> all;
+  for (int i = 1; i <= 5; ++i) all.push_back(divide(100, i));
+  int total = 0;
+  for (auto value : when_all(std::move(all)).get()) total += value;
+  std::cout << "when_all sum: " << total << '\n';
+
+  std::vector<fast_future<int>> any;
+  for (int i = 1; i <= 5; ++i) any.push_back(divide(100, i));
+  const auto [index, value] = when_any(std::move(any)).get();
+  std::cout << "when_any: future " << index << " = " << value << '\n';
+
+  std::cout << '\n';
+
+  constexpr int count = 1'000'000;
+  long long sum = 0;
+  getExecutionTime("std::promise create+fulfil+get",
+                   [&] { sum = createFulfilGet<std::promise>(count); });
+  getExecutionTime("fast_promise create+fulfil+get",
+                   [&] { sum -= createFulfilGet<fast_promise>(count); });
+  getExecutionTime("std::promise across threads",
+                   [&] { sum += crossThread<std::promise>(count); });
+  getExecutionTime("fast_promise across threads",
+                   [&] { sum -= crossThread<fast_promise>(count); });
+  if (sum != 0) {
+    std::cout << "Wrong results\n";
+  }
+
+  std::cout << '\n';
+}
@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Bounded multi-producer multi-consumer queue: every cell carries a
+// sequence number telling producers and consumers whose turn it is, so
+// push and pop are one CAS on the shared index.
+class HandleQueue {
+ public:
+  explicit HandleQueue(std::size_t capacity)
+      : cells(std::bit_ceil(capacity)), mask{cells.size() - 1} {
+    for (std::size_t i = 0; i < cells.size(); ++i) cells[i].sequence = i;
+  }
+
+  bool push(std::coroutine_handle<> handle) {
+    auto pos = tail.load(std::memory_order_relaxed);
+    while (true) {
+      auto& cell = cells[pos & mask];
+      const auto seq = cell.sequence.load(std::memory_order_acquire);
+      if (seq == pos) {
+        if (tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          cell.handle = handle;
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (seq < pos) {
+        return false;  // full
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool pop(std::coroutine_handle<>& handle) {
+    auto pos = head.load(std::memory_order_relaxed);
+    while (true) {
+      auto& cell = cells[pos & mask];
+      const auto seq = cell.sequence.load(std::memory_order_acquire);
+      if (seq == pos + 1) {
+        if (head.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          handle = cell.handle;
+          cell.sequence.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (seq < pos + 1) {
+        return false;  // empty
+      } else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    std::coroutine_handle<> handle;
+  };
+
+  std::vector<Cell> cells;
+  const std::size_t mask;
+  alignas(64) std::atomic<std::size_t> tail{0};
+  alignas(64) std::atomic<std::size_t> head{0};
+};
+
+// Symmetric transfers on this thread since its worker last resumed a
+// coroutine. GCC only turns them into tail calls at -O2, otherwise every
+// transfer grows the stack, so after maxTransfers the next coroutine goes
+// through the pool and the stack unwinds to the worker loop.
+inline thread_local unsigned transfers = 0;
+constexpr unsigned maxTransfers = 256;
+
+// Persistent worker threads resuming coroutines. Idle workers sleep on an
+// atomic counter that every schedule() bumps.
+class ThreadPool {
+ public:
+  explicit ThreadPool(unsigned numberThreads = std::max(
+                          1u, std::thread::hardware_concurrency()))
+      : queue{1 << 16} {
+    for (unsigned i = 0; i < numberThreads; ++i) {
+      workers.emplace_back([this](std::stop_token token) { run(token); });
+    }
+  }
+
+  ~ThreadPool() {
+    for (auto& worker : workers) worker.request_stop();
+    scheduled.fetch_add(1, std::memory_order_release);
+    scheduled.notify_all();
+  }
+
+  void schedule(std::coroutine_handle<> handle) {
+    while (!queue.push(handle)) std::this_thread::yield();
+    scheduled.fetch_add(1, std::memory_order_release);
+    scheduled.notify_one();
+  }
+
+ private:
+  void run(std::stop_token token) {
+    while (true) {
+      const auto seen = scheduled.load(std::memory_order_acquire);
+      std::coroutine_handle<> handle;
+      if (queue.pop(handle)) {
+        transfers = 0;
+        handle.resume();
+      } else if (token.stop_requested()) {
+        return;
+      } else {
+        scheduled.wait(seen, std::memory_order_acquire);
+      }
+    }
+  }
+
+  HandleQueue queue;
+  std::atomic<std::uint32_t> scheduled{0};
+  std::vector<std::jthread> workers;
+};
+
+ThreadPool& defaultPool() {
+  static ThreadPool pool;
+  return pool;
+}
+
+// Lazy future: the coroutine starts when get() hands it to the pool or
+// when another coroutine awaits it. Awaiting transfers control to the
+// child and back without a queue hop; the result lives in the frame.
+template <typename T>
+class Future {
+ public:
+  struct promise_type;
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  Future(Future&& other) noexcept : coro{std::exchange(other.coro, {})} {}
+  Future& operator=(Future&& other) noexcept {
+    std::swap(coro, other.coro);
+    return *this;
+  }
+  ~Future() {
+    if (coro) coro.destroy();
+  }
+
+  T get() {
+    Done done;
+    coro.promise().done = &done;
+    defaultPool().schedule(coro);
+    done.wait();
+    return coro.promise().take();
+  }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      handle_type coro;
+
+      bool await_ready() const noexcept { return false; }
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<> awaiting) noexcept {
+        coro.promise().continuation = awaiting;
+        return transferTo(coro);
+      }
+      T await_resume() { return coro.promise().take(); }
+    };
+    return Awaiter{coro};
+  }
+
+  // Signalled by the final suspend point of a coroutine started by get().
+  // The notification happens under the lock, so get() cannot return and
+  // destroy the object while it is still being notified.
+  class Done {
+   public:
+    void set() {
+      std::lock_guard lock(doneMutex);
+      isDone = true;
+      doneCondition.notify_one();
+    }
+
+    void wait() {
+      std::unique_lock lock(doneMutex);
+      doneCondition.wait(lock, [this] { return isDone; });
+    }
+
+   private:
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    bool isDone = false;
+  };
+
+  struct promise_type {
+    std::variant<std::monostate, T, std::exception_ptr> result;
+    std::coroutine_handle<> continuation;
+    Done* done = nullptr;
+
+    Future get_return_object() {
+      return Future{handle_type::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept {
+      struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(handle_type coro) noexcept {
+          auto& promise = coro.promise();
+          if (promise.continuation) {
+            return transferTo(promise.continuation);
+          }
+          promise.done->set();
+          return std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+      };
+      return FinalAwaiter{};
+    }
+
+    template <typename U>
+    void return_value(U&& value) {
+      result.template emplace<1>(std::forward<U>(value));
+    }
+    void unhandled_exception() {
+      result.template emplace<2>(std::current_exception());
+    }
+
+    T take() {
+      if (result.index() == 2) {
+        std::rethrow_exception(std::get<2>(result));
+      }
+      return std::move(std::get<1>(result));
+    }
+  };
+
+ private:
+  explicit Future(handle_type h) : coro{h} {}
+
+  static std::coroutine_handle<> transferTo(std::coroutine_handle<> next) {
+    if (++transfers < maxTransfers) return next;
+    defaultPool().schedule(next);
+    return std::noop_coroutine();
+  }
+
+  handle_type coro;
+};
+
+// MyFuture from lazyFutureOnOtherThread.cpp without the tracing
+template <typename T>
+struct MyFuture {
+  struct promise_type;
+  using handle_type = std::coroutine_handle<promise_type>;
+  handle_type coro;
+
+  MyFuture(handle_type h) : coro(h) {}
+  ~MyFuture() {
+    if (coro) coro.destroy();
+  }
+
+  T get() {
+    std::thread t([this] { coro.resume(); });
+    t.join();
+    return coro.promise().result;
+  }
+
+  struct promise_type {
+    T result;
+    auto get_return_object() {
+      return MyFuture{handle_type::from_promise(*this)};
+    }
+    void return_value(T v) { result = v; }
+    std::suspend_always initial_suspend() { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::exit(1); }
+  };
+};
+
+MyFuture<int> createMyFuture(int value) { co_return value; }
+
+Future<int> createFuture(int value) { co_return value; }
+
+Future<long long> sumFutures(int count) {
+  long long sum = 0;
+  for (int i = 0; i < count; ++i) sum += co_await createFuture(i);
+  co_return sum;
+}
+
+template <typename Func>
+void getExecutionTime(const std::string& title, int count, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  const auto sum = func();
+  const std::chrono::duration<double, std::micro> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() / count << " us per future ("
+            << sum << ")\n";
+}
+
+int main() {
+  std::cout << '\n';
+
+  std::cout << "main:  "
+            << "std::this_thread::get_id(): " << std::this_thread::get_id()
+            << '\n';
+
+  auto fut = createFuture(2021);
+  auto res = fut.get();
+  std::cout << "res: " << res << '\n';
+
+  std::cout << '\n';
+
+  constexpr int threadCount = 100'000;
+  constexpr int poolCount = 1'000'000;
+
+  getExecutionTime("thread per get()", threadCount, [] {
+    long long sum = 0;
+    for (int i = 0; i < threadCount; ++i) sum += createMyFuture(i).get();
+    return sum;
+  });
+  getExecutionTime("pool get()", poolCount, [] {
+    long long sum = 0;
+    for (int i = 0; i < poolCount; ++i) sum += createFuture(i).get();
+    return sum;
+  });
+  getExecutionTime("co_await on the pool", poolCount,
+                   [] { return sumFutures(poolCount).get(); });
+
+  std::cout << '\n';
+}
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <ranges>
+#include <semaphore>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// The classic monitor from monitorObjectCpp20.cpp, kept for comparison.
+// get() retries when another consumer popped the element between wait()
+// and lock(); with many consumers the original would pop an empty queue.
+class Monitor {
+ public:
+  void lock() const { monitMutex.lock(); }
+
+  void unlock() const { monitMutex.unlock(); }
+
+  void notify_one() const noexcept { monitCond.notify_one(); }
+
+  template <std::predicate Predicate>
+  void wait(Predicate pred) const {
+    std::unique_lock<std::mutex> monitLock(monitMutex);
+    monitCond.wait(monitLock, pred);
+  }
+
+ private:
+  mutable std::mutex monitMutex;
+  mutable std::condition_variable monitCond;
+};
+
+template <typename T>
+class ThreadSafeQueue : public Monitor {
+ public:
+  void add(T val) {
+    lock();
+    myQueue.push(val);
+    unlock();
+    notify_one();
+  }
+
+  T get() {
+    while (true) {
+      wait([this] { return !myQueue.empty(); });
+      lock();
+      if (!myQueue.empty()) {
+        auto val = myQueue.front();
+        myQueue.pop();
+        unlock();
+        return val;
+      }
+      unlock();
+    }
+  }
+
+ private:
+  std::queue<T> myQueue;
+};
+
+// Hand-off queue: a consumer that finds the queue empty parks in its own
+// slot on the stack. Producers serve parked consumers in FIFO order and put
+// the element straight into the slot, so the woken consumer never touches
+// the mutex again and nobody is woken without an element to take.
+template <typename T>
+class HandoffQueue {
+ public:
+  void add(T val) {
+    Slot* slot = nullptr;
+    {
+      std::lock_guard lock(queueMutex);
+      if (waiters.empty()) {
+        items.push_back(std::move(val));
+        return;
+      }
+      slot = waiters.front();
+      waiters.pop_front();
+      slot->value.emplace(std::move(val));
+    }
+    slot->ready.release();
+  }
+
+  // Adds all values under one lock; only the consumers that receive an
+  // element are woken. They are woken after the lock is released, also
+  // when a value throws halfway; a slot leaves the waiters only once its
+  // value is in place.
+  template <std::ranges::input_range Range>
+    requires std::convertible_to<std::ranges::range_reference_t<Range>, T>
+  void add_range(Range&& values) {
+    struct Served {
+      Slot* head = nullptr;
+      Slot** tail = &head;
+
+      ~Served() {
+        while (head) std::exchange(head, head->next)->ready.release();
+      }
+    } served;
+    std::lock_guard lock(queueMutex);
+    for (auto&& val : values) {
+      if (waiters.empty()) {
+        items.emplace_back(std::forward<decltype(val)>(val));
+        continue;
+      }
+      Slot* slot = waiters.front();
+      slot->value.emplace(std::forward<decltype(val)>(val));
+      waiters.pop_front();
+      *std::exchange(served.tail, &slot->next) = slot;
+    }
+  }
+
+  T get() {
+    Slot slot;
+    {
+      std::lock_guard lock(queueMutex);
+      if (!items.empty()) {
+        T val = std::move(items.front());
+        items.pop_front();
+        return val;
+      }
+      waiters.push_back(&slot);
+    }
+    slot.ready.acquire();
+    return std::move(*slot.value);
+  }
+
+ private:
+  struct Slot {
+    std::optional<T> value;
+    std::binary_semaphore ready{0};
+    Slot* next = nullptr;  // in the served list of add_range
+  };
+
+  std::mutex queueMutex;
+  std::deque<T> items;
+  std::deque<Slot*> waiters;
+};
+
+template <typename Func>
+double getExecutionTime(Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  return dur.count();
+}
+
+// numberThreads producers and numberThreads consumers move itemsPerThread
+// elements each through the queue.
+template <typename Queue>
+double runSingle(int numberThreads, int itemsPerThread) {
+  Queue queue;
+  std::atomic<long long> sum{};
+  const auto sec = getExecutionTime([&] {
+    std::vector<std::jthread> threads;
+    threads.reserve(2 * numberThreads);
+    for (int t = 0; t < numberThreads; ++t) {
+      threads.emplace_back([&] {
+        long long local = 0;
+        for (int i = 0; i < itemsPerThread; ++i) local += queue.get();
+        sum += local;
+      });
+    }
+    for (int t = 0; t < numberThreads; ++t) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < itemsPerThread; ++i) queue.add(1);
+      });
+    }
+  });
+  if (sum != static_cast<long long>(numberThreads) * itemsPerThread) {
+    throw std::logic_error("Lost elements");
+  }
+  return sec;
+}
+
+double runBatched(int numberThreads, int itemsPerThread, int batchSize) {
+  HandoffQueue<int> queue;
+  std::atomic<long long> sum{};
+  const auto sec = getExecutionTime([&] {
+    std::vector<std::jthread> threads;
+    threads.reserve(2 * numberThreads);
+    for (int t = 0; t < numberThreads; ++t) {
+      threads.emplace_back([&] {
+        long long local = 0;
+        for (int i = 0; i < itemsPerThread; ++i) local += queue.get();
+        sum += local;
+      });
+    }
+    for (int t = 0; t < numberThreads; ++t) {
+      threads.emplace_back([&] {
+        const std::vector<int> batch(batchSize, 1);
+        for (int i = 0; i < itemsPerThread; i += batchSize) {
+          queue.add_range(batch | std::views::take(std::min(
+                                      batchSize, itemsPerThread - i)));
+        }
+      });
+    }
+  });
+  if (sum != static_cast<long long>(numberThreads) * itemsPerThread) {
+    throw std::logic_error("Lost elements");
+  }
+  return sec;
+}
+
+int main() {
+  std::cout << '\n';
+
+  constexpr auto ItemsPerThread = 2'000;
+  constexpr auto BatchSize = 64;
+
+  for (int numberThreads : {10, 100, 1000}) {
+    std::cout << numberThreads << " producers / " << numberThreads
+              << " consumers\n";
+    std::cout << "  Monitor + ThreadSafeQueue: "
+              << runSingle<ThreadSafeQueue<int>>(numberThreads,
+                                                 ItemsPerThread)
+              << " sec.\n";
+    std::cout << "  HandoffQueue::add:         "
+              << runSingle<HandoffQueue<int>>(numberThreads, ItemsPerThread)
+              << " sec.\n";
+    std::cout << "  HandoffQueue::add_range:   "
+              << runBatched(numberThreads, ItemsPerThread, BatchSize)
+              << " sec.\n";
+  }
+
+  std::cout << '\n';
+}
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <execution>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+template <typename Policy>
+constexpr bool isUnsequenced =
+    std::is_same_v<std::remove_cvref_t<Policy>,
+                   std::execution::unsequenced_policy> ||
+    std::is_same_v<std::remove_cvref_t<Policy>,
+                   std::execution::parallel_unsequenced_policy>;
+
+template <typename Policy>
+constexpr bool isParallel =
+    std::is_same_v<std::remove_cvref_t<Policy>,
+                   std::execution::parallel_policy> ||
+    std::is_same_v<std::remove_cvref_t<Policy>,
+                   std::execution::parallel_unsequenced_policy>;
+
+// The body adds one element to the accumulator of its chunk
+template <typename Body, typename T, typename Range>
+concept ChunkBody =
+    std::invocable<Body&, T&, std::ranges::range_reference_t<Range>>;
+
+// Under unseq the body may be interleaved with itself on one thread, so
+// taking a lock deadlocks. A type check cannot see inside the body, but a
+// captureless noexcept body cannot reach a mutex through a capture, which
+// rules out the mutex-in-lambda pattern of parallelAlgorithmsHazards.cpp.
+template <typename Body, typename T, typename Range>
+concept UnsequencedBody =
+    ChunkBody<Body, T, Range> && std::is_empty_v<Body> &&
+    std::is_nothrow_invocable_v<Body&, T&,
+                                std::ranges::range_reference_t<Range>>;
+
+struct ReduceOptions {
+  std::size_t chunkSize = 1 << 14;
+  unsigned numberThreads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+// Splits the range into chunks of a fixed size, lets the body accumulate
+// every chunk into its own local value starting from identity, and
+// combines the chunk results pairwise in a fixed tree. Neither the chunks
+// nor the tree depend on the number of threads, so even floating point
+// results are bitwise identical for any thread count.
+template <typename Policy, std::ranges::random_access_range Range, typename T,
+          typename Body, typename Combine>
+  requires std::ranges::sized_range<Range> &&
+           std::is_execution_policy_v<std::remove_cvref_t<Policy>> &&
+           ChunkBody<Body, T, Range> &&
+           (!isUnsequenced<Policy> || UnsequencedBody<Body, T, Range>) &&
+           std::regular_invocable<Combine&, T, T>
+T parallel_for_each_reduce(Policy&&, Range&& rg, T identity, Body body,
+                           Combine combine, ReduceOptions options = {}) {
+  const auto size = static_cast<std::size_t>(std::ranges::ssize(rg));
+  if (size == 0) {
+    return identity;
+  }
+  const auto chunkSize = std::max<std::size_t>(options.chunkSize, 1);
+  const auto chunks = (size + chunkSize - 1) / chunkSize;
+  std::vector<T> partials(chunks, identity);
+
+  auto first = std::ranges::begin(rg);
+  auto runChunk = [&](std::size_t chunk) {
+    auto pos = first + chunk * chunkSize;
+    const auto last = first + std::min(size, (chunk + 1) * chunkSize);
+    T local = identity;
+    for (; pos != last; ++pos) body(local, *pos);
+    partials[chunk] = std::move(local);
+  };
+
+  const auto numberThreads =
+      isParallel<Policy>
+          ? std::min<std::size_t>(std::max(options.numberThreads, 1u), chunks)
+          : 1;
+  if (numberThreads == 1) {
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) runChunk(chunk);
+  } else {
+    std::atomic<std::size_t> nextChunk{0};
+    std::vector<std::jthread> workers;
+    workers.reserve(numberThreads);
+    for (std::size_t t = 0; t < numberThreads; ++t) {
+      workers.emplace_back([&] {
+        for (auto chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+          runChunk(chunk);
+        }
+      });
+    }
+  }
+
+  for (std::size_t stride = 1; stride < chunks; stride *= 2) {
+    for (std::size_t i = 0; i + stride < chunks; i += 2 * stride) {
+      partials[i] = combine(std::move(partials[i]),
+                            std::move(partials[i + stride]));
+    }
+  }
+  return std::move(partials.front());
+}
+
+template <typename Policy, typename Body>
+concept AcceptedBody = requires(Policy policy, Body body,
+                                std::vector<double>& values) {
+  parallel_for_each_reduce(policy, values, 0.0, body, std::plus{});
+};
+
+template <typename Func>
+void getExecutionTime(const std::string& title, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  const double sum = func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec. (" << std::hexfloat
+            << sum << std::defaultfloat << ")" << std::endl;
+}
+
+int main() {
+  std::cout << '\n';
+
+  auto addTwice = [](double& sum, double value) noexcept {
+    sum += value + value;
+  };
+
+  std::mutex m;
+  auto addTwiceLocked = [&m](double& sum, double value) {
+    std::lock_guard<std::mutex> lock(m);
+    sum += value + value;
+  };
+
+  // the locking body is fine for par, but does not compile for unseq
+  static_assert(AcceptedBody<std::execution::parallel_unsequenced_policy,
+                             decltype(addTwice)>);
+  static_assert(AcceptedBody<std::execution::parallel_policy,
+                             decltype(addTwiceLocked)>);
+  static_assert(!AcceptedBody<std::execution::unsequenced_policy,
+                              decltype(addTwiceLocked)>);
+  static_assert(!AcceptedBody<std::execution::parallel_unsequenced_policy,
+                              decltype(addTwiceLocked)>);
+
+  constexpr std::size_t size = 20'000'000;
+  std::vector<double> values;
+  values.reserve(size);
+  std::mt19937 engine;
+  std::uniform_real_distribution<> uniformDist(0, 1);
+  for (std::size_t i = 0; i < size; ++i) values.push_back(uniformDist(engine));
+
+  getExecutionTime("std::for_each(par) + std::mutex", [&] {
+    double sum = 0;
+    std::for_each(std::execution::par, values.begin(), values.end(),
+                  [&sum, &m](double i) {
+                    std::lock_guard<std::mutex> lock(m);
+                    sum += i + i;
+                  });
+    return sum;
+  });
+
+  getExecutionTime("parallel_for_each_reduce(par) + std::mutex", [&] {
+    return parallel_for_each_reduce(std::execution::par, values, 0.0,
+                                    addTwiceLocked, std::plus{});
+  });
+
+  getExecutionTime("std::transform_reduce(par)", [&] {
+    return std::transform_reduce(std::execution::par, values.begin(),
+                                 values.end(), 0.0, std::plus{},
+                                 [](double i) { return i + i; });
+  });
+
+  for (unsigned numberThreads : {1u, 2u, 4u, 8u}) {
+    getExecutionTime(
+        "parallel_for_each_reduce(par_unseq), " +
+            std::to_string(numberThreads) + " threads",
+        [&] {
+          return parallel_for_each_reduce(
+              std::execution::par_unseq, values, 0.0, addTwice, std::plus{},
+              {.numberThreads = numberThreads});
+        });
+  }
+
+  std::cout << '\n';
+}
@@ -0,0 +1,173 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+template <typename Signature>
+class recurring_task;
+
+// A packaged_task that can be run again and again: the callable and the
+// result slot live in the task itself, so a run allocates nothing. A
+// handle taken before a run waits for that run to finish. Only one run
+// may be in flight, and its result has to be taken before the next one.
+template <typename R, typename... Args>
+class recurring_task<R(Args...)> {
+  using Stored = std::conditional_t<std::is_void_v<R>, std::monostate, R>;
+
+ public:
+  class handle {
+   public:
+    bool is_ready() const {
+      return task->completed.load(std::memory_order_acquire) >= run;
+    }
+
+    void wait() const {
+      auto done = task->completed.load(std::memory_order_acquire);
+      while (done < run) {
+        task->completed.wait(done, std::memory_order_acquire);
+        done = task->completed.load(std::memory_order_acquire);
+      }
+    }
+
+    R get() const {
+      wait();
+      if (task->result.index() == 2) {
+        std::rethrow_exception(std::get<2>(task->result));
+      }
+      if constexpr (!std::is_void_v<R>) {
+        return std::move(std::get<1>(task->result));
+      }
+    }
+
+   private:
+    friend class recurring_task;
+
+    handle(recurring_task* task, std::uint64_t run) : task{task}, run{run} {}
+
+    recurring_task* task;
+    std::uint64_t run;
+  };
+
+  template <typename F>
+  explicit recurring_task(F&& func) : func{std::forward<F>(func)} {}
+
+  recurring_task(const recurring_task&) = delete;
+  recurring_task& operator=(const recurring_task&) = delete;
+
+  // handle for the next run
+  handle get_handle() {
+    return handle{this, completed.load(std::memory_order_relaxed) + 1};
+  }
+
+  void operator()(Args... args) {
+    try {
+      if constexpr (std::is_void_v<R>) {
+        func(std::forward<Args>(args)...);
+        result.template emplace<1>();
+      } else {
+        result.template emplace<1>(func(std::forward<Args>(args)...));
+      }
+    } catch (...) {
+      result.template emplace<2>(std::current_exception());
+    }
+    completed.fetch_add(1, std::memory_order_release);
+    completed.notify_all();
+  }
+
+ private:
+  std::function<R(Args...)> func;
+  std::variant<std::monostate, Stored, std::exception_ptr> result;
+  std::atomic<std::uint64_t> completed{0};
+};
+
+void calcProducts(std::packaged_task<int(int, int)>& task,
+                  const std::vector<std::pair<int, int>>& pairs) {
+  for (auto& pair : pairs) {
+    auto fut = task.get_future();
+    task(pair.first, pair.second);
+    std::cout << pair.first << " * " << pair.second << " = " << fut.get()
+              << '\n';
+    task.reset();
+  }
+}
+
+void calcProducts(recurring_task<int(int, int)>& task,
+                  const std::vector<std::pair<int, int>>& pairs) {
+  for (auto& pair : pairs) {
+    auto handle = task.get_handle();
+    task(pair.first, pair.second);
+    std::cout << pair.first << " * " << pair.second << " = " << handle.get()
+              << '\n';
+  }
+}
+
+template <typename Func>
+void getExecutionTime(const std::string& title, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec. " << std::endl;
+}
+
+int main() {
+  std::cout << '\n';
+
+  std::vector<std::pair<int, int>> allPairs;
+  allPairs.push_back(std::make_pair(1, 2));
+  allPairs.push_back(std::make_pair(2, 3));
+  allPairs.push_back(std::make_pair(3, 4));
+  allPairs.push_back(std::make_pair(4, 5));
+
+  auto multiply = [](int fir, int sec) { return fir * sec; };
+
+  std::packaged_task<int(int, int)> task{multiply};
+  calcProducts(task, allPairs);
+
+  std::cout << '\n';
+
+  recurring_task<int(int, int)> recurring{multiply};
+  std::thread t([&] { calcProducts(recurring, allPairs); });
+  t.join();
+
+  std::cout << '\n';
+
+  // a run on a worker thread, the result taken on this one
+  auto handle = recurring.get_handle();
+  std::jthread worker([&] { recurring(6, 7); });
+  std::cout << "6 * 7 = " << handle.get() << '\n';
+
+  std::cout << '\n';
+
+  constexpr int count = 1'000'000;
+  long long sum = 0;
+  getExecutionTime("std::packaged_task + reset()", [&] {
+    for (int i = 0; i < count; ++i) {
+      auto fut = task.get_future();
+      task(i, 2);
+      sum += fut.get();
+      task.reset();
+    }
+  });
+  getExecutionTime("recurring_task", [&] {
+    for (int i = 0; i < count; ++i) {
+      auto next = recurring.get_handle();
+      recurring(i, 2);
+      sum -= next.get();
+    }
+  });
+  if (sum != 0) {
+    std::cout << "Wrong results\n";
+  }
+
+  std::cout << '\n';
+}
@@ -0,0 +1,541 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <syncstream>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+template <typename... Args>
+void log(Args&&... args) {
+  std::osyncstream syncStream(std::cout);
+  (syncStream << ... << std::forward<Args>(args));
+}
+
+// Resumes coroutines handed over by the timer service
+class Executor {
+ public:
+  virtual ~Executor() = default;
+  virtual void schedule(std::coroutine_handle<> handle) = 0;
+};
+
+// Resumes on the thread that hands the coroutine over
+class InlineExecutor : public Executor {
+ public:
+  void schedule(std::coroutine_handle<> handle) override { handle.resume(); }
+};
+
+class ThreadPoolExecutor : public Executor {
+ public:
+  explicit ThreadPoolExecutor(unsigned numberThreads) {
+    for (unsigned i = 0; i < numberThreads; ++i) {
+      workers.emplace_back([this](std::stop_token token) { run(token); });
+    }
+  }
+
+  ~ThreadPoolExecutor() override {
+    for (auto& worker : workers) worker.request_stop();
+  }
+
+  void schedule(std::coroutine_handle<> handle) override {
+    {
+      std::lock_guard lock(queueMutex);
+      queue.push_back(handle);
+    }
+    queueCondition.notify_one();
+  }
+
+ private:
+  void run(std::stop_token token) {
+    while (true) {
+      std::unique_lock lock(queueMutex);
+      if (!queueCondition.wait(lock, token,
+                               [this] { return !queue.empty(); })) {
+        return;
+      }
+      const auto handle = queue.front();
+      queue.pop_front();
+      lock.unlock();
+      handle.resume();
+    }
+  }
+
+  std::mutex queueMutex;
+  std::condition_variable_any queueCondition;
+  std::deque<std::coroutine_handle<>> queue;
+  std::vector<std::jthread> workers;
+};
+
+// One thread sleeps until the earliest deadline of all pending sleeps and
+// hands the due coroutines to their executor. The sleeps are awaiters in
+// the coroutine frames, kept in a binary heap of pointers, and every
+// awaiter knows its heap position, so a cancelled sleep leaves the heap
+// right away without allocating.
+class TimerService {
+ public:
+  class Sleep;
+
+  TimerService()
+      : timerThread{[this](std::stop_token token) { run(token); }} {}
+
+  // Pending sleeps are resumed as cancelled; their executors have to
+  // outlive the service
+  ~TimerService();
+
+  TimerService(const TimerService&) = delete;
+  TimerService& operator=(const TimerService&) = delete;
+
+  Sleep sleep_until(Clock::time_point deadline, Executor& executor,
+                    std::stop_token token = {});
+
+  Sleep sleep_for(Clock::duration delay, Executor& executor,
+                  std::stop_token token = {});
+
+ private:
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  void run(std::stop_token token);
+
+  // heap of the earliest deadline first
+  bool earlier(std::size_t lhs, std::size_t rhs) const;
+  void place(std::size_t pos, Sleep* sleep);
+  void siftUp(std::size_t pos);
+  void siftDown(std::size_t pos);
+  void push(Sleep* sleep);
+  void remove(std::size_t pos);
+
+  std::mutex heapMutex;
+  std::condition_variable_any heapCondition;
+  std::vector<Sleep*> heap;
+  bool stopping = false;
+  std::jthread timerThread;
+};
+
+// co_await yields true after the deadline and false if the sleep was
+// cancelled through the stop token or by the end of the service
+class TimerService::Sleep {
+ public:
+  Sleep(TimerService& service, Clock::time_point deadline, Executor& executor,
+        std::stop_token token)
+      : service{&service},
+        executor{&executor},
+        deadline{deadline},
+        token{std::move(token)} {}
+
+  // only before the sleep is awaited
+  Sleep(Sleep&& other) noexcept
+      : service{other.service},
+        executor{other.executor},
+        deadline{other.deadline},
+        token{std::move(other.token)} {}
+
+  // a stopped token is handled by await_suspend, which reports the cancel
+  bool await_ready() const noexcept { return deadline <= Clock::now(); }
+
+  bool await_suspend(std::coroutine_handle<> handle) {
+    coro = handle;
+    // A stop requested while the callback is registered only marks the
+    // sleep; the coroutine must not resume before await_suspend returns.
+    if (token.stop_possible()) onStop.emplace(token, Cancel{this});
+    std::lock_guard lock(service->heapMutex);
+    if (state == StopRequested || service->stopping) {
+      state = Cancelled;
+      return false;
+    }
+    state = Waiting;
+    service->push(this);
+    return true;
+  }
+
+  bool await_resume() {
+    // blocks while a stop callback runs on another thread
+    onStop.reset();
+    return state != Cancelled;
+  }
+
+ private:
+  friend class TimerService;
+
+  enum State { Registering, StopRequested, Waiting, Fired, Cancelled };
+
+  struct Cancel {
+    Sleep* sleep;
+
+    void operator()() const noexcept {
+      auto& service = *sleep->service;
+      {
+        std::lock_guard lock(service.heapMutex);
+        if (sleep->state == Registering) {
+          sleep->state = StopRequested;
+          return;
+        }
+        if (sleep->state != Waiting) return;
+        sleep->state = Cancelled;
+        service.remove(sleep->heapIndex);
+      }
+      sleep->executor->schedule(sleep->coro);
+    }
+  };
+
+  TimerService* service;
+  Executor* executor;
+  Clock::time_point deadline;
+  std::stop_token token;
+  std::optional<std::stop_callback<Cancel>> onStop;
+  std::coroutine_handle<> coro;
+  State state = Registering;
+  std::size_t heapIndex = npos;
+};
+
+TimerService::~TimerService() {
+  std::vector<Sleep*> pending;
+  {
+    std::lock_guard lock(heapMutex);
+    stopping = true;
+    pending.swap(heap);
+    for (auto* sleep : pending) sleep->state = Sleep::Cancelled;
+  }
+  timerThread.request_stop();
+  timerThread.join();
+  for (auto* sleep : pending) sleep->executor->schedule(sleep->coro);
+}
+
+TimerService::Sleep TimerService::sleep_until(Clock::time_point deadline,
+                                              Executor& executor,
+                                              std::stop_token token) {
+  return Sleep{*this, deadline, executor, std::move(token)};
+}
+
+TimerService::Sleep TimerService::sleep_for(Clock::duration delay,
+                                            Executor& executor,
+                                            std::stop_token token) {
+  return sleep_until(Clock::now() + delay, executor, std::move(token));
+}
+
+void TimerService::run(std::stop_token token) {
+  std::vector<Sleep*> due;
+  std::unique_lock lock(heapMutex);
+  while (!token.stop_requested()) {
+    if (heap.empty()) {
+      heapCondition.wait(lock, token, [this] { return !heap.empty(); });
+      continue;
+    }
+    const auto now = Clock::now();
+    while (!heap.empty() && heap.front()->deadline <= now) {
+      heap.front()->state = Sleep::Fired;
+      due.push_back(heap.front());
+      remove(0);
+    }
+    if (!due.empty()) {
+      lock.unlock();
+      for (auto* sleep : due) sleep->executor->schedule(sleep->coro);
+      due.clear();
+      lock.lock();
+      continue;
+    }
+    // woken early by a new earliest deadline, a cancel or the stop
+    const auto deadline = heap.front()->deadline;
+    heapCondition.wait_until(lock, token, deadline, [this, deadline] {
+      return heap.empty() || heap.front()->deadline < deadline;
+    });
+  }
+}
+
+bool TimerService::earlier(std::size_t lhs, std::size_t rhs) const {
+  return heap[lhs]->deadline < heap[rhs]->deadline;
+}
+
+void TimerService::place(std::size_t pos, Sleep* sleep) {
+  heap[pos] = sleep;
+  sleep->heapIndex = pos;
+}
+
+void TimerService::siftUp(std::size_t pos) {
+  while (pos > 0) {
+    const auto parent = (pos - 1) / 2;
+    if (!earlier(pos, parent)) break;
+    auto* sleep = heap[pos];
+    place(pos, heap[parent]);
+    place(parent, sleep);
+    pos = parent;
+  }
+}
+
+void TimerService::siftDown(std::size_t pos) {
+  while (true) {
+    auto smallest = pos;
+    for (auto child : {2 * pos + 1, 2 * pos + 2}) {
+      if (child < heap.size() && earlier(child, smallest)) smallest = child;
+    }
+    if (smallest == pos) break;
+    auto* sleep = heap[pos];
+    place(pos, heap[smallest]);
+    place(smallest, sleep);
+    pos = smallest;
+  }
+}
+
+void TimerService::push(Sleep* sleep) {
+  heap.push_back(sleep);
+  sleep->heapIndex = heap.size() - 1;
+  siftUp(sleep->heapIndex);
+  if (sleep->heapIndex == 0) heapCondition.notify_one();
+}
+
+void TimerService::remove(std::size_t pos) {
+  heap[pos]->heapIndex = npos;
+  const auto last = heap.back();
+  heap.pop_back();
+  if (pos < heap.size()) {
+    place(pos, last);
+    siftUp(pos);
+    siftDown(last->heapIndex);
+  }
+}
+
+InlineExecutor& inlineExecutor() {
+  static InlineExecutor executor;
+  return executor;
+}
+
+// The static executor is constructed first, so it outlives the service,
+// which still hands pending sleeps to it when it is destroyed
+TimerService& defaultTimerService() {
+  inlineExecutor();
+  static TimerService service;
+  return service;
+}
+
+// Eager task. The frame is shared by the Task object and the running
+// coroutine and destroyed by whichever of them finishes last, so
+// destroying the Task while a timer resumes the coroutine is safe.
+struct Task {
+  struct promise_type {
+    std::atomic<int> references{2};
+    std::atomic<bool> done{false};
+    int returnedValue{};
+
+    Task get_return_object() {
+      return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    std::suspend_never initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept {
+      struct Release {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+          auto& promise = h.promise();
+          promise.done.store(true, std::memory_order_release);
+          promise.done.notify_all();
+          if (promise.references.fetch_sub(1, std::memory_order_acq_rel) ==
+              1) {
+            h.destroy();
+          }
+        }
+        void await_resume() noexcept {}
+      };
+      return Release{};
+    }
+
+    void unhandled_exception() { std::terminate(); }
+
+    void return_value(int value) { returnedValue = value; }
+
+    // co_await on a duration sleeps on the shared timer thread
+    auto await_transform(Clock::duration delay) {
+      return defaultTimerService().sleep_for(delay, inlineExecutor());
+    }
+
+    template <typename Awaitable>
+      requires(!std::convertible_to<Awaitable, Clock::duration>)
+    Awaitable&& await_transform(Awaitable&& awaitable) {
+      return std::forward<Awaitable>(awaitable);
+    }
+  };
+
+  explicit Task(std::coroutine_handle<promise_type> h) : handle{h} {}
+  Task(Task&& other) noexcept : handle{std::exchange(other.handle, {})} {}
+  Task& operator=(Task&&) = delete;
+
+  ~Task() {
+    if (handle && handle.promise().references.fetch_sub(
+                      1, std::memory_order_acq_rel) == 1) {
+      handle.destroy();
+    }
+  }
+
+  int get() const {
+    handle.promise().done.wait(false, std::memory_order_acquire);
+    return handle.promise().returnedValue;
+  }
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+Task f() {
+  log("f() on ", std::this_thread::get_id(), '\n');
+  co_await 1000ms;
+  log("f() resumed on ", std::this_thread::get_id(), '\n');
+  co_return 42;
+}
+
+Task cancellable(std::stop_token token, Executor& executor) {
+  const bool slept =
+      co_await defaultTimerService().sleep_for(10s, executor, token);
+  log("cancellable(): ", slept ? "slept" : "cancelled", '\n');
+  co_return slept;
+}
+
+// the detached thread of co_await_transform
+struct ThreadSleep {
+  Clock::time_point deadline;
+  bool failed = false;
+
+  bool await_ready() const { return false; }
+  bool await_suspend(std::coroutine_handle<> h) {
+    try {
+      std::jthread{[h, deadline = deadline] {
+        std::this_thread::sleep_until(deadline);
+        h.resume();
+      }}.detach();
+      return true;
+    } catch (const std::system_error&) {
+      failed = true;
+      return false;
+    }
+  }
+  bool await_resume() const { return !failed; }
+};
+
+// Outlives the benchmark: the last sleeper still notifies after main()
+// has seen the final count
+struct Stats {
+  std::vector<double> lateness;
+  std::vector<char> slept;
+  std::atomic<std::size_t> finished{0};
+};
+
+template <typename MakeAwaitable>
+Task sleeper(MakeAwaitable makeAwaitable, Clock::time_point deadline,
+             Stats& stats, std::size_t index) {
+  const bool slept = co_await makeAwaitable(deadline);
+  const std::chrono::duration<double, std::micro> late =
+      Clock::now() - deadline;
+  stats.lateness[index] = late.count();
+  stats.slept[index] = slept;
+  stats.finished.fetch_add(1, std::memory_order_release);
+  stats.finished.notify_one();
+  co_return 0;
+}
+
+std::size_t readStatus(const std::string& field) {
+  std::ifstream status("/proc/self/status");
+  for (std::string key; status >> key;) {
+    if (key == field + ":") {
+      std::size_t value = 0;
+      status >> value;
+      return value;
+    }
+  }
+  return 0;
+}
+
+template <typename MakeAwaitable>
+void benchmark(const std::string& title, std::size_t count,
+               MakeAwaitable makeAwaitable) {
+  static Stats stats;
+  stats.lateness.assign(count, 0);
+  stats.slept.assign(count, false);
+  stats.finished = 0;
+
+  // peak thread count and memory while the sleeps are pending
+  const auto rssBefore = readStatus("VmRSS");
+  std::size_t peakThreads = 0;
+  std::size_t peakRss = 0;
+  {
+    std::jthread sampler{[&](std::stop_token token) {
+      while (!token.stop_requested()) {
+        peakThreads = std::max(peakThreads, readStatus("Threads"));
+        peakRss = std::max(peakRss, readStatus("VmRSS"));
+        std::this_thread::sleep_for(5ms);
+      }
+    }};
+
+    const auto deadline = Clock::now() + 1s;
+    for (std::size_t i = 0; i < count; ++i) {
+      sleeper(makeAwaitable, deadline, stats, i);
+    }
+
+    for (auto done = stats.finished.load(std::memory_order_acquire);
+         done < count; done = stats.finished.load(std::memory_order_acquire)) {
+      stats.finished.wait(done);
+    }
+  }
+  const auto threads = peakThreads - 1;  // without the sampler
+  const auto rss = peakRss > rssBefore ? peakRss - rssBefore : 0;
+
+  std::vector<double> lateness;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (stats.slept[i]) lateness.push_back(stats.lateness[i]);
+  }
+  std::ranges::sort(lateness);
+  std::cout << title << ": " << lateness.size() << " of " << count
+            << " sleeps, peak " << threads << " threads, " << rss / 1024
+            << " MiB more RSS\n";
+  if (!lateness.empty()) {
+    std::cout << "  lateness median " << lateness[lateness.size() / 2]
+              << " us, p99 " << lateness[lateness.size() * 99 / 100]
+              << " us, max " << lateness.back() << " us\n";
+  }
+}
+
+int main() {
+  auto task = f();
+  log("Back in main() on ", std::this_thread::get_id(), '\n');
+  log("ReturnedValue ", task.get(), "\n\n");
+
+  {
+    ThreadPoolExecutor pool{2};
+    std::stop_source stop;
+    auto cancelled = cancellable(stop.get_token(), pool);
+    std::this_thread::sleep_for(100ms);
+    stop.request_stop();
+    cancelled.get();
+  }
+  {
+    // stopped before the sleep starts
+    std::stop_source stop;
+    stop.request_stop();
+    cancellable(stop.get_token(), inlineExecutor()).get();
+  }
+
+  std::cout << '\n';
+
+  constexpr std::size_t count = 100'000;
+  benchmark("timer service", count, [](Clock::time_point deadline) {
+    return defaultTimerService().sleep_until(deadline, inlineExecutor());
+  });
+  std::this_thread::sleep_for(100ms);
+  benchmark("thread per sleep", count, [](Clock::time_point deadline) {
+    return ThreadSleep{deadline};
+  });
+
+  return 0;
+}
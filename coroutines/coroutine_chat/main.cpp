@@ -2,17 +2,23 @@
 // SPDX-License-Identifier: MIT
 // https://github.com/andreasfertig/heise-2024-11-cpp20-coroutinen-teil-1
 
+#include <chrono>
 #include <coroutine>
+#include <cstddef>
 #include <cstdio>
 #include <exception>  // std::terminate
 #include <iostream>
 #include <list>
 #include <new>
 #include <string>
+#include <string_view>
 #include <utility>
 
 using namespace std::literals;
 
+// Counts the coroutine frames the benchmark takes from the heap
+thread_local std::size_t heapFrames = 0;
+
 struct Chat {
   struct promise_type {
     std::string _msgOut{};
@@ -26,6 +32,14 @@ struct Chat {
 
     std::suspend_always initial_suspend() noexcept { return {}; }  // #D Startup
 
+    static void* operator new(std::size_t size) {
+      ++heapFrames;
+      return ::operator new(size);
+    }
+    static void operator delete(void* p, std::size_t size) noexcept {
+      ::operator delete(p, size);
+    }
+
     std::suspend_always yield_value(
         std::string msg) noexcept  // #F Value from co_yield
     {
@@ -86,7 +100,7 @@ struct Chat {
   void answer(std::string msg)  // #F Send data to the coroutine
                                 // and activate it.
   {
-    mHandle.promise()._msgIn = msg;
+    mHandle.promise()._msgIn = std::move(msg);
     if (not mHandle.done()) {
       mHandle.resume();
     }
@@ -106,6 +120,181 @@ Chat Fun()  // #A Wrapper type Chat containing the
                          // promise_type.return_value
 }
 
+// Keeps the frames of finished coroutines of one promise type for the next
+// ones on the same thread. The frames of different coroutines differ in
+// size, so there is a free list for every 64 bytes of size up to 1 KB;
+// larger frames go to the heap.
+template <typename Tag>
+class FramePool {
+ public:
+  static void* allocate(std::size_t size) {
+    const auto sizeClass = classOf(size);
+    if (sizeClass < classes) {
+      auto& list = local().lists[sizeClass];
+      if (list.head != nullptr) {
+        --list.count;
+        return std::exchange(list.head, list.head->next);
+      }
+    }
+    ++heapFrames;
+    return ::operator new(blockSize(size));
+  }
+
+  static void deallocate(void* p, std::size_t size) noexcept {
+    const auto sizeClass = classOf(size);
+    if (sizeClass < classes) {
+      auto& list = local().lists[sizeClass];
+      if (list.count < maxBlocks) {
+        list.head = ::new (p) Block{list.head};
+        ++list.count;
+        return;
+      }
+    }
+    ::operator delete(p, blockSize(size));
+  }
+
+ private:
+  static constexpr std::size_t granule = 64;
+  static constexpr std::size_t classes = 1024 / granule;
+  static constexpr std::size_t maxBlocks = 1024;
+
+  static std::size_t classOf(std::size_t size) {
+    return (size - 1) / granule;
+  }
+  static std::size_t blockSize(std::size_t size) {
+    return (classOf(size) + 1) * granule;
+  }
+
+  struct Block {
+    Block* next;
+  };
+
+  struct List {
+    Block* head = nullptr;
+    std::size_t count = 0;
+  };
+
+  struct Local {
+    ~Local() {
+      for (std::size_t c = 0; c < classes; ++c) {
+        while (lists[c].head != nullptr) {
+          ::operator delete(std::exchange(lists[c].head, lists[c].head->next),
+                            (c + 1) * granule);
+        }
+      }
+    }
+
+    List lists[classes];
+  };
+
+  static Local& local() {
+    thread_local Local pool;
+    return pool;
+  }
+};
+
+// A Chat for many short conversations. The frames come from a FramePool,
+// and the messages are string_views: a co_yield operand lives until the
+// coroutine resumes and an answer lives in the caller's buffer until the
+// call of answer() returns, so neither is copied. co_yield evaluates to
+// the answer, so the coroutine runs up to its greeting when it is created
+// and a conversation takes a single resume.
+struct PooledChat {
+  struct promise_type {
+    std::string_view _msgOut{};
+    std::string_view _msgIn{};
+    std::string _lastOut{};  // the co_return value outlives the body
+
+    static void* operator new(std::size_t size) {
+      return FramePool<promise_type>::allocate(size);
+    }
+    static void operator delete(void* p, std::size_t size) noexcept {
+      FramePool<promise_type>::deallocate(p, size);
+    }
+
+    void unhandled_exception() noexcept { std::terminate(); }
+
+    PooledChat get_return_object() { return PooledChat{*this}; }
+
+    std::suspend_never initial_suspend() noexcept { return {}; }
+
+    auto yield_value(std::string_view msg) noexcept {
+      struct awaiter {
+        promise_type& pt;
+        constexpr bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        std::string_view await_resume() const noexcept { return pt._msgIn; }
+      };
+
+      _msgOut = msg;
+      return awaiter{*this};
+    }
+
+    void return_value(std::string msg) noexcept {
+      _lastOut = std::move(msg);
+      _msgOut = _lastOut;
+    }
+
+    std::suspend_always final_suspend() noexcept { return {}; }
+  };
+
+  std::coroutine_handle<promise_type> mHandle{};
+
+  explicit PooledChat(promise_type& p)
+      : mHandle{std::coroutine_handle<promise_type>::from_promise(p)} {}
+
+  PooledChat(PooledChat&& rhs) : mHandle{std::exchange(rhs.mHandle, nullptr)} {}
+
+  ~PooledChat() {
+    if (mHandle) {
+      mHandle.destroy();
+    }
+  }
+
+  // the last message of the coroutine, valid until the next answer()
+  std::string_view listen() const { return mHandle.promise()._msgOut; }
+
+  // msg only has to live until the call returns
+  void answer(std::string_view msg) {
+    mHandle.promise()._msgIn = msg;
+    if (not mHandle.done()) {
+      mHandle.resume();
+    }
+  }
+};
+
+PooledChat PooledFun() {
+  std::cout << (co_yield "Hello!\n"sv);
+
+  co_return "Here!\n"s;
+}
+
+// the conversations of the benchmark, without output
+Chat Echo() {
+  co_yield "Hello!\n"s;
+  const auto question = co_await std::string{};
+  co_return question.size() > 10 ? "Here!\n"s : "Pardon?\n"s;
+}
+
+PooledChat PooledEcho() {
+  const auto question = co_yield "Hello!\n"sv;
+  co_return question.size() > 10 ? "Here!\n"s : "Pardon?\n"s;
+}
+
+template <typename Func>
+void benchmark(const std::string& title, std::size_t count, Func func) {
+  const auto framesBefore = heapFrames;
+  const auto sta = std::chrono::steady_clock::now();
+  std::size_t chars = 0;
+  for (std::size_t i = 0; i < count; ++i) chars += func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << count / dur.count() / 1e6
+            << " million conversations/sec., "
+            << static_cast<double>(heapFrames - framesBefore) / count
+            << " heap frames/conversation (" << chars << " chars)\n";
+}
+
 int main() {
   Chat marco = Fun();  // #E Creation of the coroutine
 
@@ -116,4 +305,24 @@ int main() {
 
   std::cout << marco.listen();  // #H Wait for more data from
                                 // the coroutine
+
+  PooledChat polo = PooledFun();
+  std::cout << polo.listen();
+  polo.answer("Where are you?\n");
+  std::cout << polo.listen() << '\n';
+
+  constexpr std::size_t count = 1'000'000;
+  const std::string question = "Where are you? I cannot see you.\n";
+  benchmark("Chat", count, [&] {
+    Chat chat = Echo();
+    auto chars = chat.listen().size();
+    chat.answer(question);
+    return chars + chat.listen().size();
+  });
+  benchmark("PooledChat", count, [&] {
+    PooledChat chat = PooledEcho();
+    auto chars = chat.listen().size();
+    chat.answer(question);
+    return chars + chat.listen().size();
+  });
 }
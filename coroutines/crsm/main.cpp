@@ -1,10 +1,39 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <coroutine>
+#include <cstddef>
+#include <exception>
 #include <iostream>
+#include <new>
+#include <string>
+#include <utility>
 
 // Coroutine State Machine
 
 // Compiles with: GCC 11.1 (GCC 10.2 -fcoroutines), Clang 15.0.0, msvc 19.30
 
+// Counts the coroutine frames and their live bytes for the benchmark; the
+// promise types allocate their frames through it
+struct FrameStats {
+  static inline std::size_t allocations = 0;
+  static inline std::size_t liveBytes = 0;
+  static inline std::size_t peakBytes = 0;
+
+  static void* allocate(std::size_t size) {
+    void* p = ::operator new(size);
+    ++allocations;
+    liveBytes += size;
+    peakBytes = std::max(peakBytes, liveBytes);
+    return p;
+  }
+
+  static void deallocate(void* p, std::size_t size) noexcept {
+    liveBytes -= size;
+    ::operator delete(p, size);
+  }
+};
+
 class [[nodiscard]] CoState {
  public:
   struct promise_type;
@@ -40,6 +69,13 @@ class [[nodiscard]] CoState {
 
     void return_void() const noexcept {}
 
+    static void* operator new(std::size_t size) {
+      return FrameStats::allocate(size);
+    }
+    static void operator delete(void* p, std::size_t size) noexcept {
+      FrameStats::deallocate(p, size);
+    }
+
     CoState::CoroHandle nextHandle = nullptr;
   };
 
@@ -104,10 +140,250 @@ CoState state3(int num) {
   }
 }
 
+// A state machine with one coroutine per state, created once. A
+// transition stores the argument in the machine and transfers control
+// symmetrically to the frame of the next state, which continues its loop
+// with the argument, so no frame is allocated and neither the stack nor a
+// chain of parents grows. The states are resumed from run() and hand
+// control back with stop().
+//
+// Symmetric transfer only keeps the stack flat where the compiler turns
+// the resume into a tail call, which GCC does at -O2 but not at -O1, -O0
+// or with the address sanitizer. So after a run of transitions control
+// returns to run(), which resumes the next state; that bounds the stack
+// for every build at the cost of one extra resume per run.
+
+template <typename Arg, std::size_t NumStates>
+class Machine {
+ public:
+  class [[nodiscard]] State {
+   public:
+    struct promise_type {
+      State get_return_object() {
+        return State{std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+
+      // a state starts when it is entered for the first time
+      std::suspend_always initial_suspend() const noexcept { return {}; }
+      std::suspend_always final_suspend() const noexcept { return {}; }
+
+      void unhandled_exception() { std::terminate(); }
+
+      void return_void() const noexcept {}
+
+      static void* operator new(std::size_t size) {
+        return FrameStats::allocate(size);
+      }
+      static void operator delete(void* p, std::size_t size) noexcept {
+        FrameStats::deallocate(p, size);
+      }
+    };
+
+    State(State&& other) noexcept : hnd{std::exchange(other.hnd, nullptr)} {}
+
+    State& operator=(State&& other) noexcept {
+      std::swap(hnd, other.hnd);
+      return *this;
+    }
+
+    ~State() {
+      if (hnd) {
+        hnd.destroy();
+      }
+    }
+
+   private:
+    friend class Machine;
+
+    State() = default;
+    explicit State(std::coroutine_handle<promise_type> h) : hnd{h} {}
+
+    std::coroutine_handle<promise_type> hnd = nullptr;
+  };
+
+  // suspends the current state and resumes the next one; yields the
+  // argument of the next transition into the current state
+  struct Transition {
+    Machine& machine;
+    std::coroutine_handle<> next;  // none for stop()
+
+    constexpr bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<>) noexcept {
+      if (next && ++machine.transfers < maxTransfers) return next;
+      machine.following = next;
+      return std::noop_coroutine();
+    }
+
+    Arg await_resume() { return std::move(machine.pending); }
+  };
+
+  Machine() = default;
+  Machine(const Machine&) = delete;
+  Machine& operator=(const Machine&) = delete;
+
+  void set(std::size_t id, State state) { states[id] = std::move(state); }
+
+  // the argument of the transition into a state that has just started
+  Arg arg() { return std::move(pending); }
+
+  Transition go(std::size_t id, Arg argument) {
+    pending = std::move(argument);
+    return {*this, states[id].hnd};
+  }
+
+  // returns from run(); the state continues with the argument of the
+  // next run() that enters it
+  Transition stop() { return {*this, nullptr}; }
+
+  void run(std::size_t id, Arg argument) {
+    pending = std::move(argument);
+    for (std::coroutine_handle<> next = states[id].hnd; next;) {
+      transfers = 0;
+      next.resume();
+      next = std::exchange(following, nullptr);
+    }
+  }
+
+ private:
+  // symmetric transfers before control returns to run()
+  static constexpr unsigned maxTransfers = 64;
+
+  std::array<State, NumStates> states{};
+  Arg pending{};
+  unsigned transfers = 0;
+  std::coroutine_handle<> following;
+};
+
+enum StateId : std::size_t { State1, State2, State3 };
+using CoMachine = Machine<int, 3>;
+
+CoMachine::State machineState1(CoMachine& m) {
+  for (auto num = m.arg();;) {
+    std::cout << "State 1 " << num << "\n";
+    // not co_await on ?:, GCC 12 evaluates both arms
+    if (num > 3) {
+      num = co_await m.go(State2, num - 3);
+    } else {
+      num = co_await m.go(State3, 7);
+    }
+  }
+}
+
+CoMachine::State machineState2(CoMachine& m) {
+  for (auto num = m.arg();;) {
+    std::cout << "State 2 " << num << "\n";
+    num = co_await m.go(State1, num - 2);
+  }
+}
+
+CoMachine::State machineState3(CoMachine& m) {
+  for (auto num = m.arg();;) {
+    std::cout << "State 3 " << num << "\n";
+    if (num > 0) {
+      num = co_await m.go(State3, num - 2);
+    } else {
+      num = co_await m.stop();
+    }
+  }
+}
+
+// Three states in a cycle for the benchmark, each counting one transition
+CoState chainA(long& steps);
+CoState chainB(long& steps);
+CoState chainC(long& steps);
+
+CoState chainA(long& steps) {
+  if (--steps > 0) co_await chainB(steps);
+}
+
+CoState chainB(long& steps) {
+  if (--steps > 0) co_await chainC(steps);
+}
+
+CoState chainC(long& steps) {
+  if (--steps > 0) co_await chainA(steps);
+}
+
+using CycleMachine = Machine<long, 3>;
+
+CycleMachine::State cycleState(CycleMachine& m, std::size_t next) {
+  for (auto steps = m.arg();;) {
+    if (--steps > 0) {
+      steps = co_await m.go(next, steps);
+    } else {
+      steps = co_await m.stop();
+    }
+  }
+}
+
+// The same cycle as a table of plain functions, each returning the id of
+// the next state, driven by a loop
+using Step = std::size_t (*)(long&);
+constexpr std::size_t stopId = 3;
+
+template <std::size_t Next>
+std::size_t tableStep(long& steps) {
+  return --steps > 0 ? Next : stopId;
+}
+
+constexpr std::array<Step, 3> transitionTable{tableStep<1>, tableStep<2>,
+                                              tableStep<0>};
+
+template <typename Func>
+void benchmark(const std::string& title, long steps, Func func) {
+  const auto allocationsBefore = FrameStats::allocations;
+  const auto liveBefore = FrameStats::liveBytes;
+  FrameStats::peakBytes = FrameStats::liveBytes;
+  const auto sta = std::chrono::steady_clock::now();
+  func(steps);
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << steps / dur.count() / 1e6
+            << " million transitions/sec., "
+            << FrameStats::allocations - allocationsBefore
+            << " frames, peak " << FrameStats::peakBytes - liveBefore
+            << " bytes\n";
+}
+
 int main() {
   CoState machine = state1(10);
 
   machine.start();  // Start and wait for the end of execution
 
+  std::cout << '\n';
+
+  CoMachine m;
+  m.set(State1, machineState1(m));
+  m.set(State2, machineState2(m));
+  m.set(State3, machineState3(m));
+  m.run(State1, 10);
+
+  std::cout << '\n';
+
+  constexpr long steps = 10'000'000;
+  // every transition of a chain keeps a frame alive until the chain ends,
+  // and only tail-called transfers keep the stack flat, so it runs as
+  // short chains
+  benchmark("CoState chains", steps / 10, [](long count) {
+    constexpr long length = 10'000;
+    for (; count > 0; count -= length) {
+      long chainSteps = length;
+      CoState chain = chainA(chainSteps);
+      chain.start();
+    }
+  });
+  benchmark("Machine, fixed frames", steps, [](long count) {
+    CycleMachine cycle;
+    for (std::size_t id = 0; id < 3; ++id) {
+      cycle.set(id, cycleState(cycle, (id + 1) % 3));
+    }
+    cycle.run(0, count);
+  });
+  benchmark("transition table", steps, [](long count) {
+    for (std::size_t id = 0; id != stopId; id = transitionTable[id](count)) {
+    }
+  });
+
   return 0;
 }
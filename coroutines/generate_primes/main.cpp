@@ -1,5 +1,22 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 // Compiles with: GCC 11.1 (GCC 10.2 -fcoroutines), Clang 15.0.0, msvc 19.30
 
@@ -78,6 +95,248 @@ CoGenerator allPrimeNumbers() {
   }
 }
 
+// Segmented Sieve of Eratosthenes over odd numbers only, one bit per
+// number. A segment of 32 KB fits the L1 cache, and it starts from a
+// copy of the wheel, the pattern of the multiples of 3, 5, 7, 11 and 13,
+// so only the primes from 17 on are crossed off one by one.
+namespace sieve {
+
+using Prime = unsigned long long;
+
+constexpr std::size_t segmentBits = std::size_t{1} << 18;
+constexpr std::array<Prime, 5> wheelPrimes{3, 5, 7, 11, 13};
+constexpr std::size_t wheelPeriod = 3 * 5 * 7 * 11 * 13;  // odd numbers
+
+// Bit k stands for 2k + 1 and is set unless a wheel prime divides it.
+// Two periods and a word more, so that 64 bits can be read from any
+// offset within the first period.
+const std::vector<std::uint64_t>& wheel() {
+  static const auto pattern = [] {
+    std::vector<std::uint64_t> words((2 * wheelPeriod + 63) / 64 + 1);
+    for (std::size_t k = 0; k < words.size() * 64; ++k) {
+      const auto n = 2 * (k % wheelPeriod) + 1;
+      if (std::ranges::none_of(wheelPrimes,
+                               [n](Prime p) { return n % p == 0; })) {
+        words[k / 64] |= std::uint64_t{1} << (k % 64);
+      }
+    }
+    return words;
+  }();
+  return pattern;
+}
+
+std::uint64_t readBits(const std::vector<std::uint64_t>& words,
+                       std::size_t offset) {
+  const auto shift = offset % 64;
+  const auto low = words[offset / 64] >> shift;
+  return shift == 0 ? low : low | words[offset / 64 + 1] << (64 - shift);
+}
+
+Prime isqrt(Prime n) {
+  auto root = static_cast<Prime>(std::sqrt(static_cast<double>(n)));
+  while (root * root > n) --root;
+  while ((root + 1) * (root + 1) <= n) ++root;
+  return root;
+}
+
+// the primes above the wheel up to limit, by a plain sieve
+std::vector<Prime> basePrimes(Prime limit) {
+  std::vector<bool> composite(limit + 1);
+  std::vector<Prime> primes;
+  for (Prime n = 3; n <= limit; n += 2) {
+    if (composite[n]) continue;
+    if (n > wheelPrimes.back()) primes.push_back(n);
+    for (auto m = n * n; m <= limit; m += 2 * n) composite[m] = true;
+  }
+  return primes;
+}
+
+// Sieves the odd numbers of [lo, lo + 2 * bits) into words; lo is odd and
+// base has to hold the primes up to the square root of the end
+void sieveSegment(Prime lo, std::size_t bits, std::span<const Prime> base,
+                  std::vector<std::uint64_t>& words) {
+  const auto& pattern = wheel();
+  words.resize((bits + 63) / 64);
+  auto offset = static_cast<std::size_t>(lo / 2 % wheelPeriod);
+  for (auto& word : words) {
+    word = readBits(pattern, offset);
+    offset = (offset + 64) % wheelPeriod;
+  }
+  if (bits % 64 != 0) words.back() &= (std::uint64_t{1} << bits % 64) - 1;
+
+  const auto end = lo + 2 * bits;
+  for (const auto p : base) {
+    if (p * p >= end) break;
+    auto first = std::max(p * p, (lo + p - 1) / p * p);
+    if (first % 2 == 0) first += p;
+    for (auto i = (first - lo) / 2; i < bits; i += p) {
+      words[i / 64] &= ~(std::uint64_t{1} << (i % 64));
+    }
+  }
+
+  // the pattern takes 1 for a prime and the wheel primes for composites
+  if (lo == 1) words[0] &= ~std::uint64_t{1};
+  for (const auto p : wheelPrimes) {
+    if (p >= lo && p < end) {
+      words[(p - lo) / 128] |= std::uint64_t{1} << ((p - lo) / 2 % 64);
+    }
+  }
+}
+
+// numberThreads - 1 threads that live as long as the pool; run() hands
+// the tasks [0, count) out to them and to the calling thread and returns
+// once all are done
+class Workers {
+ public:
+  explicit Workers(unsigned numberThreads) {
+    for (unsigned t = 1; t < numberThreads; ++t) {
+      threads.emplace_back([this](std::stop_token token) { work(token); });
+    }
+  }
+
+  Workers(const Workers&) = delete;
+  Workers& operator=(const Workers&) = delete;
+
+  void run(std::size_t count, std::function<void(std::size_t)> func) {
+    {
+      std::lock_guard lock(mutex);
+      task = std::move(func);
+      tasks = count;
+      next = 0;
+      busy = threads.size();
+      ++generation;
+    }
+    started.notify_all();
+    process();
+    std::unique_lock lock(mutex);
+    finished.wait(lock, [this] { return busy == 0; });
+  }
+
+ private:
+  void process() {
+    for (auto i = next++; i < tasks; i = next++) task(i);
+  }
+
+  void work(std::stop_token token) {
+    std::size_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock lock(mutex);
+        if (!started.wait(lock, token,
+                          [&] { return generation != seen; })) {
+          return;
+        }
+        seen = generation;
+      }
+      process();
+      std::lock_guard lock(mutex);
+      if (--busy == 0) finished.notify_one();
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable_any started;
+  std::condition_variable finished;
+  std::function<void(std::size_t)> task;
+  std::size_t tasks = 0;
+  std::atomic<std::size_t> next = 0;
+  std::size_t busy = 0;
+  std::size_t generation = 0;
+  std::vector<std::jthread> threads;  // last, stopped and joined first
+};
+
+// The odd primes of [lo, hi), lo odd. Segments are handed out to the
+// workers: the first pass sieves and counts them, the second writes the
+// primes of every segment to their place in the result.
+std::vector<Prime> sieveRange(Prime lo, Prime hi, std::span<const Prime> base,
+                              Workers& workers) {
+  if (hi <= lo) return {};
+  const auto segments = (hi - lo + 2 * segmentBits - 1) / (2 * segmentBits);
+  std::vector<std::vector<std::uint64_t>> sieved(segments);
+  std::vector<std::size_t> offsets(segments + 1);
+  std::vector<Prime> primes;
+
+  auto segmentStart = [&](std::size_t s) { return lo + 2 * segmentBits * s; };
+  auto forEachSegment = [&](auto func) { workers.run(segments, func); };
+
+  forEachSegment([&](std::size_t s) {
+    const auto first = segmentStart(s);
+    const auto bits = static_cast<std::size_t>(
+        std::min<Prime>(segmentBits, (hi - first + 1) / 2));
+    sieveSegment(first, bits, base, sieved[s]);
+    for (const auto word : sieved[s]) offsets[s + 1] += std::popcount(word);
+  });
+
+  for (std::size_t s = 0; s < segments; ++s) offsets[s + 1] += offsets[s];
+  primes.resize(offsets.back());
+
+  forEachSegment([&](std::size_t s) {
+    const auto first = segmentStart(s);
+    auto out = primes.begin() + static_cast<std::ptrdiff_t>(offsets[s]);
+    for (std::size_t w = 0; w < sieved[s].size(); ++w) {
+      for (auto word = sieved[s][w]; word != 0; word &= word - 1) {
+        *out++ = first + 2 * (64 * w + std::countr_zero(word));
+      }
+    }
+    sieved[s] = {};
+  });
+  return primes;
+}
+
+}  // namespace sieve
+
+// all primes of [lo, hi)
+std::vector<unsigned long long> primes_in_range(
+    unsigned long long lo, unsigned long long hi,
+    unsigned numberThreads = std::max(1u,
+                                      std::thread::hardware_concurrency())) {
+  std::vector<unsigned long long> primes;
+  if (lo <= 2 && hi > 2) primes.push_back(2);
+  const auto first = std::max(lo, 1ULL) | 1;
+  if (hi <= first) return primes;
+  const auto base = sieve::basePrimes(sieve::isqrt(hi - 1));
+  sieve::Workers workers{numberThreads};
+  auto odd = sieve::sieveRange(first, hi, base, workers);
+  if (primes.empty()) return odd;
+  primes.insert(primes.end(), odd.begin(), odd.end());
+  return primes;
+}
+
+// The same generator API, but the coroutine sieves a batch of segments
+// at once, in parallel on threads kept in its frame, and then hands out
+// one prime after the other
+CoGenerator allPrimeNumbersSieved(
+    unsigned numberThreads = std::max(1u,
+                                      std::thread::hardware_concurrency())) {
+  co_yield 2;
+
+  const auto batch = 2 * sieve::segmentBits * 8 * numberThreads;
+  sieve::Workers workers{numberThreads};
+  std::vector<sieve::Prime> base;
+  sieve::Prime baseLimit = 0;
+  for (sieve::Prime lo = 1;; lo += batch) {
+    const auto hi = lo + batch;
+    if (baseLimit * baseLimit < hi) {
+      baseLimit = std::max(2 * baseLimit, sieve::isqrt(hi) + 1);
+      base = sieve::basePrimes(baseLimit);
+    }
+    for (const auto prime : sieve::sieveRange(lo, hi, base, workers)) {
+      co_yield prime;
+    }
+  }
+}
+
+template <typename Func>
+void getExecutionTime(const std::string& title, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  const auto [count, last] = func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec., "
+            << count / dur.count() / 1e6 << " million primes/sec. (" << count
+            << " primes, last " << last << ")\n";
+}
+
 int main() {
   int cnt = 10;
   CoGenerator gen = allPrimeNumbers();
@@ -85,6 +344,50 @@ int main() {
   for (int i = 0; i < cnt; ++i) {
     std::cout << gen.getNextPrime() << ' ';
   }
+  std::cout << '\n';
+
+  CoGenerator sieved = allPrimeNumbersSieved();
+  for (int i = 0; i < cnt; ++i) {
+    std::cout << sieved.getNextPrime() << ' ';
+  }
+  std::cout << '\n';
+
+  for (auto prime : primes_in_range(1'000'000'000, 1'000'000'100)) {
+    std::cout << prime << ' ';
+  }
+  std::cout << "\n\n";
+
+  // the primes below 10^7 and 10^9 one at a time
+  auto nextPrimes = [](CoGenerator generator, unsigned long long limit) {
+    std::size_t count = 0;
+    unsigned long long last = 0;
+    for (auto prime = generator.getNextPrime(); prime < limit;
+         prime = generator.getNextPrime()) {
+      ++count;
+      last = prime;
+    }
+    return std::pair{count, last};
+  };
+  getExecutionTime("trial division, getNextPrime() up to 10^7",
+                   [&] { return nextPrimes(allPrimeNumbers(), 10'000'000); });
+  getExecutionTime("sieve, getNextPrime() up to 10^7", [&] {
+    return nextPrimes(allPrimeNumbersSieved(), 10'000'000);
+  });
+  getExecutionTime("sieve, getNextPrime() up to 10^9", [&] {
+    return nextPrimes(allPrimeNumbersSieved(), 1'000'000'000);
+  });
+
+  const auto threads = std::to_string(std::thread::hardware_concurrency());
+  getExecutionTime("primes_in_range(0, 10^9), " + threads + " threads", [] {
+    const auto primes = primes_in_range(0, 1'000'000'000);
+    return std::pair{primes.size(), primes.back()};
+  });
+  getExecutionTime(
+      "primes_in_range(9 * 10^9, 10^10), " + threads + " threads", [] {
+        const auto primes =
+            primes_in_range(9'000'000'000ULL, 10'000'000'000ULL);
+        return std::pair{primes.size(), primes.back()};
+      });
 
   return 0;
 }
@@ -2,10 +2,16 @@
 // https://www.youtube.com/watch?v=ltesWt-92xw
 
 #include <array>
+#include <chrono>
 #include <coroutine>
+#include <cstddef>
+#include <exception>
 #include <iostream>
+#include <memory>
 #include <random>
 #include <string>
+#include <string_view>
+#include <utility>
 
 template <typename T>
 struct generator {
@@ -69,10 +75,139 @@ generator<std::string> card_dealer(int deck_size) {
   }
 }
 
+// Like generator, but the promise only keeps the address of the yielded
+// value: the operand of co_yield lives until the coroutine is resumed, so
+// value() can return a reference to it and nothing is copied
+template <typename T>
+struct ref_generator {
+  struct promise_type;
+  using coroutine_handle = std::coroutine_handle<promise_type>;
+
+  struct promise_type {
+    const T* current_value = nullptr;
+
+    auto get_return_object() {
+      return ref_generator{coroutine_handle::from_promise(*this)};
+    }
+
+    auto initial_suspend() { return std::suspend_always{}; }
+    auto final_suspend() noexcept { return std::suspend_always{}; }
+
+    void unhandled_exception() { std::terminate(); }
+
+    auto yield_value(const T& value) {
+      current_value = std::addressof(value);
+      return std::suspend_always{};
+    }
+  };
+
+  ref_generator(ref_generator&& other) noexcept
+      : coroutine{std::exchange(other.coroutine, nullptr)} {}
+
+  ref_generator& operator=(ref_generator&& other) noexcept {
+    std::swap(coroutine, other.coroutine);
+    return *this;
+  }
+
+  bool next() {
+    return coroutine ? (coroutine.resume(), !coroutine.done()) : false;
+  }
+
+  // valid until the next call of next()
+  [[nodiscard]] const T& value() const {
+    return *coroutine.promise().current_value;
+  }
+
+  ~ref_generator() {
+    if (coroutine) {
+      coroutine.destroy();
+    }
+  }
+
+ private:
+  ref_generator(coroutine_handle h) : coroutine(h) {}
+  coroutine_handle coroutine;
+};
+
+constexpr std::array<std::string_view, 13> card_names = {
+    "Ace", "2", "3",  "4",    "5",     "6",   "7",
+    "8",   "9", "10", "Jack", "Queen", "King"};
+
+constexpr std::array<std::string_view, 4> suit_names = {"Clubs", "Diamonds",
+                                                        "Spades", "Hearts"};
+
+// All 52 names, built once; index is card * 4 + suit
+const std::array<std::string, 52>& card_table() {
+  static const auto table = [] {
+    std::array<std::string, 52> names;
+    for (std::size_t i = 0; i < names.size(); ++i) {
+      names[i].append(card_names[i / 4]).append(" of ").append(
+          suit_names[i % 4]);
+    }
+    return names;
+  }();
+  return table;
+}
+
+// Yields views into the table: no allocation per card
+ref_generator<std::string_view> card_dealer_interned(int deck_size) {
+  std::default_random_engine rng;
+  std::uniform_int_distribution<int> card(0, 12);
+  std::uniform_int_distribution<int> suit(0, 3);
+
+  const auto& table = card_table();
+  for (int i = 0; i < deck_size; i++) {
+    const auto c = card(rng);
+    co_yield std::string_view{table[c * 4 + suit(rng)]};
+  }
+}
+
+// Builds every name in the same buffer, which stops allocating once it
+// holds the longest name, for values that cannot be precomputed
+ref_generator<std::string> card_dealer_buffered(int deck_size) {
+  std::default_random_engine rng;
+  std::uniform_int_distribution<int> card(0, 12);
+  std::uniform_int_distribution<int> suit(0, 3);
+
+  std::string buffer;
+  for (int i = 0; i < deck_size; i++) {
+    const auto c = card(rng);
+    buffer.assign(card_names[c]).append(" of ").append(suit_names[suit(rng)]);
+    co_yield buffer;
+  }
+}
+
+template <typename Generator>
+void benchmark(const std::string& title, Generator dealer, int deck_size) {
+  const auto sta = std::chrono::steady_clock::now();
+  std::size_t chars = 0;
+  while (dealer.next()) {
+    chars += dealer.value().size();
+  }
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << title << ": " << dur.count() << " sec., "
+            << deck_size / dur.count() / 1e6 << " million cards/sec. ("
+            << chars << " chars)\n";
+}
+
 int main() {
   generator<std::string> dealer = card_dealer(100);
 
   while (dealer.next()) {
     std::cout << dealer.value() << std::endl;
   }
+
+  ref_generator<std::string_view> interned = card_dealer_interned(5);
+  while (interned.next()) {
+    std::cout << interned.value() << '\n';
+  }
+  std::cout << '\n';
+
+  constexpr int deck_size = 10'000'000;
+  benchmark("generator<std::string>", card_dealer(deck_size), deck_size);
+  benchmark("ref_generator<std::string>, buffer",
+            card_dealer_buffered(deck_size), deck_size);
+  benchmark("ref_generator<std::string_view>, interned",
+            card_dealer_interned(deck_size), deck_size);
 }
@@ -7,12 +7,14 @@
 // * Suspend innermost coroutine
 // * Resume innermost coroutine
 // * Resume outer coroutine from inner coroutine
+// * Cancel the async call stack with a stop token
 
 #include <cassert>
 #include <coroutine>
 #include <exception>
 #include <optional>
 #include <print>
+#include <stop_token>
 #include <utility>
 
 /* The scheduler will resume a suspended innermost coroutine with provided data.
@@ -21,15 +23,23 @@ struct Scheduler {
   std::coroutine_handle<> to_resume;  // A nested coroutine to be resumed
   int resume_value = -1;              // Value that coroutine is waiting for
 
-  /* Supply data to and resume the nested coroutine
+  /* Supply data to and resume the nested coroutine; a cancelled coroutine
+   * has already left, so there may be none
    */
   void resumeWithData(int j) {
     resume_value = j;
     auto h = std::exchange(to_resume, std::coroutine_handle<>{});
-    h.resume();
+    if (h) h.resume();
   }
 };
 
+/* Thrown by an awaitable that was unparked by a stop request; it unwinds
+ * the async call stack like any other exception.
+ */
+struct operation_cancelled : std::exception {
+  const char* what() const noexcept override { return "operation cancelled"; }
+};
+
 /* Base class for all promises.
  */
 struct promise_base {
@@ -39,6 +49,7 @@ struct promise_base {
       parentHandle;  // handle to parent in the async call stack
   std::coroutine_handle<> selfHandle;  // handle to self
   Scheduler* scheduler = nullptr;      // pointer to a scheduler
+  std::stop_token stopToken;  // inherited from the parent when awaited
   virtual ~promise_base() = default;
 
   /* Set a scheduler for this promise and all its descendants along the async
@@ -53,12 +64,26 @@ struct promise_base {
 };
 
 /* An awaitable that waits for data supplied by a scheduler.
+ * A stop request on the stop token of the async call stack unparks it
+ * early: the scheduler loses the coroutine and the co_await throws
+ * operation_cancelled.
  */
 struct GetData {
+  struct Unpark {
+    GetData* self;
+    void operator()() noexcept {
+      self->cancelled = true;
+      std::exchange(self->promise->scheduler->to_resume, {}).resume();
+    }
+  };
+
   promise_base* promise = nullptr;
+  bool cancelled = false;
+  std::optional<std::stop_callback<Unpark>> onStop;
+
   bool await_ready() { return false; }
   template <typename Promise_T>
-  void await_suspend(std::coroutine_handle<Promise_T> h) {
+  bool await_suspend(std::coroutine_handle<Promise_T> h) {
     promise = &(h.promise());
     // Depending on when the scheduler was set, it may have already propagated
     // to all nodes, or it may only reside in the root promise of the async call
@@ -78,11 +103,21 @@ struct GetData {
          it = it->parent) {
       it->scheduler = sched;
     }
+    if (promise->stopToken.stop_requested()) {
+      cancelled = true;
+      return false;
+    }
     // Register ourselves as the coroutine that the scheduler should wake up
     assert(!sched->to_resume);
     sched->to_resume = h;
+    // The scheduler is single-threaded, so the stop request that runs the
+    // callback comes after this function has returned
+    onStop.emplace(promise->stopToken, Unpark{this});
+    return true;
   }
   int await_resume() {
+    onStop.reset();
+    if (cancelled) throw operation_cancelled{};
     // When we wake up, the scheduler will have the data that we were waiting
     // for
     return promise->scheduler->resume_value;
@@ -108,6 +143,7 @@ template <typename T>
 struct Async {
   struct promise_type : public promise_base {
     std::optional<T> opt_return_value = std::nullopt;
+    std::exception_ptr exception;
 
     Async get_return_object() {
       return Async{std::coroutine_handle<promise_type>::from_promise(*this)};
@@ -134,7 +170,10 @@ struct Async {
       };
       return ResumeCaller{parentHandle};
     }
-    void unhandled_exception() noexcept { std::terminate(); }
+    // rethrown in the parent by await_resume
+    void unhandled_exception() noexcept {
+      exception = std::current_exception();
+    }
     void return_value(T v) {
       assert(!opt_return_value.has_value());
       opt_return_value = v;
@@ -163,6 +202,7 @@ struct Async {
     self.promise().parent = &(h_other.promise());
     self.promise().parentHandle = h_other;
     self.promise().selfHandle = self;
+    self.promise().stopToken = h_other.promise().stopToken;
     assert(h_other.promise().child == nullptr);
     h_other.promise().child = &(self.promise());
 
@@ -173,6 +213,9 @@ struct Async {
   T await_resume() {
     // Unregister ourselves from our parent when we resume
     self.promise().parent->child = nullptr;
+    if (self.promise().exception) {
+      std::rethrow_exception(self.promise().exception);
+    }
     return self.promise().opt_return_value.value();
   }
 
@@ -196,9 +239,12 @@ struct AsyncResult {
 
     std::suspend_never initial_suspend() { return {}; }
     std::suspend_always final_suspend() noexcept { return {}; }
-    void unhandled_exception() noexcept { std::terminate(); }
+    void unhandled_exception() noexcept {
+      exception = std::current_exception();
+    }
     void return_value(T val) { result = val; }
     std::optional<T> result;
+    std::exception_ptr exception;
   };
 
   std::coroutine_handle<promise_type> self;
@@ -214,10 +260,15 @@ struct AsyncResult {
     }
   }
 
-  /* Retrieve the result of a completed asynchronous operation
+  /* Retrieve the result of a completed asynchronous operation; rethrows
+   * the exception that ended it, like operation_cancelled
    */
   T result() {
-    assert(self && self.promise().result);
+    assert(self);
+    if (self.promise().exception) {
+      std::rethrow_exception(self.promise().exception);
+    }
+    assert(self.promise().result);
     return self.promise().result.value();
   }
 };
@@ -226,10 +277,13 @@ struct AsyncResult {
  * This symmetrically transfers control to the task, which could then suspend
  * again in its body somewhere. Once the task has run to completion, the result
  * can be obtained from the returned AsyncResult object.
+ * Every coroutine on the async call stack inherits the stop token.
  */
 template <typename T>
-AsyncResult<T> spawn_task(Scheduler& scheduler, Async<T> task) {
+AsyncResult<T> spawn_task(Scheduler& scheduler, Async<T> task,
+                          std::stop_token token = {}) {
   task.setScheduler(scheduler);
+  (co_await GetCallStack{})->stopToken = std::move(token);
   co_return co_await task;
 }
 
@@ -287,4 +341,19 @@ int main() {
   // all coroutines have run to completion; the result value can now be
   // obtained from AsyncResult
   std::println("Result value is {}", async_result.result());
+
+  std::println("*** Cancellation ***");
+  std::stop_source source;
+  AsyncResult<int> cancelled_result =
+      spawn_task(sched, outer_function(11), source.get_token());
+  // inner_function waits for data again; the stop request resumes it right
+  // away, and operation_cancelled unwinds all three coroutines, so the
+  // scheduler has nothing left to resume
+  source.request_stop();
+  sched.resumeWithData(2);
+  try {
+    cancelled_result.result();
+  } catch (const operation_cancelled& e) {
+    std::println("Result: {}", e.what());
+  }
 }
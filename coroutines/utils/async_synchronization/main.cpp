@@ -0,0 +1,561 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <latch>
+#include <mutex>
+#include <semaphore>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Synchronization for coroutines: a coroutine that has to wait is
+// suspended and queued instead of blocking its thread, so the thread goes
+// on with other coroutines.
+
+// Where a coroutine continues when it is woken up
+class Executor {
+ public:
+  virtual void post(std::coroutine_handle<> handle) = 0;
+
+ protected:
+  ~Executor() = default;
+};
+
+// A suspended coroutine in a waiter list; it lives in the awaiter, which
+// is part of the coroutine frame. Without an executor it is resumed
+// inline by the thread that wakes it.
+struct Waiter {
+  std::coroutine_handle<> handle;
+  Waiter* next = nullptr;
+  Executor* executor = nullptr;
+
+  void wake() {
+    if (executor) {
+      executor->post(handle);
+    } else {
+      handle.resume();
+    }
+  }
+};
+
+// Lock-free stack of waiters. The waiters are taken all at once and
+// reversed, so they come out in the order they were pushed. Once the stack
+// is closed, pushes fail.
+class WaiterStack {
+ public:
+  // false if the stack is closed
+  bool push(Waiter* waiter) noexcept {
+    auto* head = head_.load(std::memory_order_relaxed);
+    do {
+      if (head == &closedMarker) return false;
+      waiter->next = head;
+    } while (!head_.compare_exchange_weak(head, waiter,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+    return true;
+  }
+
+  Waiter* take_all() noexcept {
+    return reverse(head_.exchange(nullptr, std::memory_order_acquire));
+  }
+
+  Waiter* close() noexcept {
+    auto* head = head_.exchange(&closedMarker, std::memory_order_acq_rel);
+    return head == &closedMarker ? nullptr : reverse(head);
+  }
+
+ private:
+  static Waiter* reverse(Waiter* head) noexcept {
+    Waiter* fifo = nullptr;
+    while (head) {
+      fifo = std::exchange(head, std::exchange(head->next, fifo));
+    }
+    return fifo;
+  }
+
+  static inline Waiter closedMarker;
+
+  std::atomic<Waiter*> head_{nullptr};
+};
+
+// The counter holds the free permits, or minus the number of waiting
+// coroutines. A release that finds waiters hands its permits directly to
+// as many of the oldest ones, so a coroutine that arrives later cannot
+// take them first, and wakes each of them on its own executor. Only the
+// waiter list is locked, never a resumption.
+template <std::ptrdiff_t LeastMaxValue = PTRDIFF_MAX>
+class async_counting_semaphore {
+ public:
+  explicit async_counting_semaphore(std::ptrdiff_t desired)
+      : count_(desired) {}
+
+  async_counting_semaphore(const async_counting_semaphore&) = delete;
+  async_counting_semaphore& operator=(const async_counting_semaphore&) =
+      delete;
+
+  static constexpr std::ptrdiff_t max() noexcept { return LeastMaxValue; }
+
+  // A waiting coroutine continues on executor once it gets its permit,
+  // without one on the thread that released it
+  auto acquire(Executor* executor = nullptr) noexcept {
+    struct awaiter : Waiter {
+      async_counting_semaphore& semaphore;
+
+      bool await_ready() noexcept {
+        return semaphore.count_.fetch_sub(1, std::memory_order_acquire) > 0;
+      }
+      // does not suspend if a permit was handed over before the push; the
+      // coroutine may be resumed on another thread as soon as it is pushed
+      bool await_suspend(std::coroutine_handle<> h) noexcept {
+        handle = h;
+        return semaphore.push(this);
+      }
+      void await_resume() noexcept {}
+    };
+    return awaiter{{{}, nullptr, executor}, *this};
+  }
+
+  auto acquire(Executor& executor) noexcept { return acquire(&executor); }
+
+  bool try_acquire() noexcept {
+    auto count = count_.load(std::memory_order_relaxed);
+    while (count > 0) {
+      if (count_.compare_exchange_weak(count, count - 1,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void release(std::ptrdiff_t update = 1) noexcept {
+    const auto before = count_.fetch_add(update, std::memory_order_release);
+    if (before < 0) hand_off(std::min(update, -before));
+  }
+
+ private:
+  bool push(Waiter* waiter) noexcept {
+    std::lock_guard lock(mutex_);
+    // a permit handed off before this waiter was queued
+    if (owed_ > 0) {
+      --owed_;
+      return false;
+    }
+    (tail_ ? tail_->next : head_) = waiter;
+    tail_ = waiter;
+    return true;
+  }
+
+  // Hands one permit to each of the oldest waiters; the ones that counted
+  // themselves but are not queued yet take theirs in push()
+  void hand_off(std::ptrdiff_t permits) noexcept {
+    Waiter* woken = nullptr;
+    {
+      std::lock_guard lock(mutex_);
+      Waiter** last = &woken;
+      for (; permits > 0 && head_; --permits) {
+        *last = std::exchange(head_, head_->next);
+        last = &(*last)->next;
+      }
+      *last = nullptr;
+      if (!head_) tail_ = nullptr;
+      owed_ += permits;
+    }
+    while (woken) std::exchange(woken, woken->next)->wake();
+  }
+
+  std::atomic<std::ptrdiff_t> count_;
+  std::mutex mutex_;
+  Waiter* head_ = nullptr;  // queued waiters, oldest first
+  Waiter* tail_ = nullptr;
+  std::ptrdiff_t owed_ = 0;  // permits for waiters not queued yet
+};
+
+using async_binary_semaphore = async_counting_semaphore<1>;
+
+// A semaphore with one permit; co_await scoped_lock() returns a lock that
+// unlocks at the end of its scope
+class async_mutex {
+ public:
+  auto lock(Executor* executor = nullptr) noexcept {
+    return semaphore_.acquire(executor);
+  }
+  bool try_lock() noexcept { return semaphore_.try_acquire(); }
+  void unlock() noexcept { semaphore_.release(); }
+
+  auto scoped_lock(Executor* executor = nullptr) noexcept {
+    struct awaiter {
+      async_mutex& mutex;
+      decltype(mutex.semaphore_.acquire()) acquire;
+
+      bool await_ready() noexcept { return acquire.await_ready(); }
+      bool await_suspend(std::coroutine_handle<> h) noexcept {
+        return acquire.await_suspend(h);
+      }
+      std::unique_lock<async_mutex> await_resume() noexcept {
+        return {mutex, std::adopt_lock};
+      }
+    };
+    return awaiter{*this, semaphore_.acquire(executor)};
+  }
+
+  auto scoped_lock(Executor& executor) noexcept {
+    return scoped_lock(&executor);
+  }
+
+ private:
+  async_binary_semaphore semaphore_{1};
+};
+
+// Waiting coroutines are woken by the count_down() that reaches zero, in
+// the order they started to wait: posted to their executor, or without one
+// resumed inline on the thread that calls it.
+class async_latch {
+ public:
+  explicit async_latch(std::ptrdiff_t expected) : counter_(expected) {
+    if (expected <= 0) waiters_.close();
+  }
+
+  async_latch(const async_latch&) = delete;
+  async_latch& operator=(const async_latch&) = delete;
+
+  void count_down(std::ptrdiff_t n = 1) noexcept {
+    if (counter_.fetch_sub(n, std::memory_order_acq_rel) != n) return;
+    for (auto* waiter = waiters_.close(); waiter;) {
+      auto* next = waiter->next;
+      waiter->wake();
+      waiter = next;
+    }
+  }
+
+  bool try_wait() const noexcept {
+    return counter_.load(std::memory_order_acquire) <= 0;
+  }
+
+  auto wait(Executor* executor = nullptr) noexcept {
+    struct awaiter : Waiter {
+      async_latch& latch;
+
+      bool await_ready() noexcept { return latch.try_wait(); }
+      // does not suspend if the latch opened in between
+      bool await_suspend(std::coroutine_handle<> h) noexcept {
+        handle = h;
+        return latch.waiters_.push(this);
+      }
+      void await_resume() noexcept {}
+    };
+    return awaiter{{{}, nullptr, executor}, *this};
+  }
+
+  auto wait(Executor& executor) noexcept { return wait(&executor); }
+
+  auto arrive_and_wait(std::ptrdiff_t n = 1,
+                       Executor* executor = nullptr) noexcept {
+    count_down(n);
+    return wait(executor);
+  }
+
+ private:
+  std::atomic<std::ptrdiff_t> counter_;
+  WaiterStack waiters_;
+};
+
+// ThreadPool and Detached from awaitable_coroutines
+class ThreadPool : public Executor {
+ public:
+  explicit ThreadPool(unsigned numberThreads) {
+    for (unsigned i = 0; i < numberThreads; ++i) {
+      workers_.emplace_back([this](std::stop_token token) { run(token); });
+    }
+  }
+
+  ~ThreadPool() {
+    for (auto& worker : workers_) worker.request_stop();
+  }
+
+  // co_await pool.schedule() continues on one of the threads
+  auto schedule() {
+    struct awaiter {
+      ThreadPool& pool;
+      bool await_ready() noexcept { return false; }
+      // a worker may resume the coroutine and free this awaiter before
+      // the notification
+      void await_suspend(std::coroutine_handle<> handle) {
+        auto& target = pool;
+        {
+          std::lock_guard lock(target.mutex_);
+          target.queue_.push_back(handle);
+        }
+        target.condition_.notify_one();
+      }
+      void await_resume() noexcept {}
+    };
+    return awaiter{*this};
+  }
+
+  // Woken coroutines run before the scheduled ones, they may just have
+  // got a lock or a permit
+  void post(std::coroutine_handle<> handle) override {
+    {
+      std::lock_guard lock(mutex_);
+      queue_.push_front(handle);
+    }
+    condition_.notify_one();
+  }
+
+ private:
+  void run(std::stop_token token) {
+    while (true) {
+      std::unique_lock lock(mutex_);
+      if (!condition_.wait(lock, token, [this] { return !queue_.empty(); })) {
+        return;
+      }
+      const auto handle = queue_.front();
+      queue_.pop_front();
+      lock.unlock();
+      handle.resume();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable_any condition_;
+  std::deque<std::coroutine_handle<>> queue_;
+  std::vector<std::jthread> workers_;
+};
+
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+Detached waitForData(ThreadPool& pool, async_latch& ready, int& data,
+                     std::latch& finished) {
+  co_await pool.schedule();
+  std::cout << "Waiter: Waiting for data.\n";
+  co_await ready.wait();
+  std::cout << "Waiter: Got " << data << ".\n";
+  finished.count_down();
+}
+
+Detached prepareData(ThreadPool& pool, async_latch& ready, int& data,
+                     std::latch& finished) {
+  co_await pool.schedule();
+  data = 42;
+  std::cout << "Sender: Data prepared.\n";
+  ready.count_down();
+  finished.count_down();
+}
+
+// The benchmark runs 10k coroutines on 4 threads. The first 1000 hold a
+// lock or a permit while they do 400 us of blocking work, the others do
+// 100 us without one. The std primitives block the waiting pool threads,
+// which then cannot run the other coroutines.
+constexpr int numberCoroutines = 10'000;
+constexpr unsigned numberThreads = 4;
+constexpr auto workTime = std::chrono::microseconds(100);
+constexpr auto lockedTime = std::chrono::microseconds(400);
+
+Detached work(ThreadPool& pool, std::latch& finished) {
+  co_await pool.schedule();
+  std::this_thread::sleep_for(workTime);
+  finished.count_down();
+}
+
+Detached withAsyncMutex(ThreadPool& pool, async_mutex& mutex, long& counter,
+                        std::latch& finished) {
+  co_await pool.schedule();
+  {
+    auto lock = co_await mutex.scoped_lock(pool);
+    std::this_thread::sleep_for(lockedTime);
+    ++counter;
+  }
+  finished.count_down();
+}
+
+Detached withStdMutex(ThreadPool& pool, std::mutex& mutex, long& counter,
+                      std::latch& finished) {
+  co_await pool.schedule();
+  {
+    std::lock_guard lock(mutex);
+    std::this_thread::sleep_for(lockedTime);
+    ++counter;
+  }
+  finished.count_down();
+}
+
+template <typename Semaphore>
+Detached withAsyncSemaphore(ThreadPool& pool, Semaphore& semaphore,
+                            std::atomic<long>& counter,
+                            std::latch& finished) {
+  co_await pool.schedule();
+  co_await semaphore.acquire(pool);
+  std::this_thread::sleep_for(lockedTime);
+  ++counter;
+  semaphore.release();
+  finished.count_down();
+}
+
+template <typename Semaphore>
+Detached withStdSemaphore(ThreadPool& pool, Semaphore& semaphore,
+                          std::atomic<long>& counter, std::latch& finished) {
+  co_await pool.schedule();
+  semaphore.acquire();
+  std::this_thread::sleep_for(lockedTime);
+  ++counter;
+  semaphore.release();
+  finished.count_down();
+}
+
+// Records the most coroutines holding a permit at the same time
+Detached holdPermit(ThreadPool& pool, async_counting_semaphore<2>& semaphore,
+                    std::atomic<int>& holders, std::atomic<int>& mostHolders,
+                    std::latch& finished) {
+  co_await pool.schedule();
+  co_await semaphore.acquire(pool);
+  const auto now = ++holders;
+  auto most = mostHolders.load();
+  while (most < now && !mostHolders.compare_exchange_weak(most, now)) {
+  }
+  std::this_thread::sleep_for(lockedTime);
+  --holders;
+  semaphore.release();
+  finished.count_down();
+}
+
+Detached waitOnLatch(ThreadPool& pool, async_latch& latch,
+                     std::latch& finished) {
+  co_await pool.schedule();
+  co_await latch.wait(pool);
+  finished.count_down();
+}
+
+template <typename Spawn>
+void benchmark(const std::string& title, Spawn spawn) {
+  ThreadPool pool{numberThreads};
+  std::latch finished{numberCoroutines};
+  const auto sta = std::chrono::steady_clock::now();
+  for (int i = 0; i < numberCoroutines; ++i) {
+    if (i < numberCoroutines / 10) {
+      spawn(pool, finished);
+    } else {
+      work(pool, finished);
+    }
+  }
+  finished.wait();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  std::cout << "  " << title << ": " << dur.count() << " sec.\n";
+}
+
+int main() {
+  {
+    ThreadPool pool{2};
+    async_latch ready{1};
+    int data = 0;
+    std::latch finished{2};
+    waitForData(pool, ready, data, finished);
+    prepareData(pool, ready, data, finished);
+    finished.wait();
+  }
+
+  // the two permits of a semaphore have to be held at the same time
+  {
+    ThreadPool pool{numberThreads};
+    async_counting_semaphore<2> semaphore{2};
+    std::atomic<int> holders = 0;
+    std::atomic<int> mostHolders = 0;
+    constexpr int count = 100;
+    std::latch finished{count};
+    for (int i = 0; i < count; ++i) {
+      holdPermit(pool, semaphore, holders, mostHolders, finished);
+    }
+    finished.wait();
+    std::cout << "\nMost concurrent holders of 2 permits: " << mostHolders
+              << '\n';
+  }
+
+  std::cout << '\n' << numberCoroutines << " coroutines on " << numberThreads
+            << " threads\n";
+
+  long asyncCounter = 0;
+  async_mutex asyncMutex;
+  benchmark("async_mutex", [&](ThreadPool& pool, std::latch& finished) {
+    withAsyncMutex(pool, asyncMutex, asyncCounter, finished);
+  });
+  long stdCounter = 0;
+  std::mutex stdMutex;
+  benchmark("std::mutex", [&](ThreadPool& pool, std::latch& finished) {
+    withStdMutex(pool, stdMutex, stdCounter, finished);
+  });
+
+  std::atomic<long> asyncPermits = 0;
+  async_counting_semaphore<2> asyncSemaphore{2};
+  benchmark("async_counting_semaphore, 2 permits",
+            [&](ThreadPool& pool, std::latch& finished) {
+              withAsyncSemaphore(pool, asyncSemaphore, asyncPermits,
+                                 finished);
+            });
+  std::atomic<long> stdPermits = 0;
+  std::counting_semaphore<2> stdSemaphore{2};
+  benchmark("std::counting_semaphore, 2 permits",
+            [&](ThreadPool& pool, std::latch& finished) {
+              withStdSemaphore(pool, stdSemaphore, stdPermits, finished);
+            });
+
+  if (asyncCounter != stdCounter || asyncPermits != stdPermits) {
+    std::cout << "Different counts\n";
+  }
+
+  // std::latch::wait() would block a thread per waiter, so the std side
+  // uses one thread per waiter
+  std::cout << '\n' << numberCoroutines << " waiters on a latch\n";
+  {
+    ThreadPool pool{numberThreads};
+    async_latch latch{1};
+    std::latch finished{numberCoroutines};
+    for (int i = 0; i < numberCoroutines; ++i) {
+      waitOnLatch(pool, latch, finished);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const auto sta = std::chrono::steady_clock::now();
+    latch.count_down();
+    finished.wait();
+    const std::chrono::duration<double> dur =
+        std::chrono::steady_clock::now() - sta;
+    std::cout << "  async_latch, " << numberThreads
+              << " threads: " << dur.count() << " sec. to resume all\n";
+  }
+  {
+    std::latch latch{1};
+    std::latch finished{numberCoroutines};
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < numberCoroutines; ++i) {
+      threads.emplace_back([&] {
+        latch.wait();
+        finished.count_down();
+      });
+    }
+    const auto sta = std::chrono::steady_clock::now();
+    latch.count_down();
+    finished.wait();
+    const std::chrono::duration<double> dur =
+        std::chrono::steady_clock::now() - sta;
+    std::cout << "  std::latch, " << numberCoroutines
+              << " threads: " << dur.count() << " sec. to resume all\n";
+  }
+
+  return 0;
+}
@@ -1,11 +1,23 @@
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <coroutine>
+#include <cstddef>
 #include <cstdio>
+#include <deque>
 #include <list>
+#include <mutex>
 #include <queue>
+#include <ranges>
+#include <semaphore>
+#include <stdexcept>
+#include <stop_token>
 #include <thread>
+#include <tuple>
 #include <utility>
+#include <variant>
+#include <vector>
 
 template <typename promise_type>
 struct owning_handle {
@@ -47,13 +59,24 @@ struct owning_handle {
   std::coroutine_handle<promise_type> handle_;
 };
 
+// Collects the children of when_all and when_any: every child reports
+// its end and gets back the coroutine to continue with
+struct CompletionGroup {
+  virtual std::coroutine_handle<> child_done(std::size_t index) noexcept = 0;
+
+ protected:
+  ~CompletionGroup() = default;
+};
+
 struct ContinuationAwaitable {
   bool await_ready() noexcept { return false; }
   std::coroutine_handle<> await_suspend(std::coroutine_handle<>) noexcept {
-    return continuation_;
+    return group_ ? group_->child_done(index_) : continuation_;
   }
   void await_resume() noexcept {}
   std::coroutine_handle<> continuation_{std::noop_coroutine()};
+  CompletionGroup* group_ = nullptr;
+  std::size_t index_ = 0;
 };
 
 template <typename T>
@@ -66,7 +89,9 @@ struct AwaitableFunction {
     }
 
     std::suspend_always initial_suspend() noexcept { return {}; }
-    ContinuationAwaitable final_suspend() noexcept { return {continuation_}; }
+    ContinuationAwaitable final_suspend() noexcept {
+      return {continuation_, group_, index_};
+    }
     // Same logic as in Function example
     template <std::convertible_to<T> Arg>
     void return_value(Arg&& result) {
@@ -75,6 +100,8 @@ struct AwaitableFunction {
     void unhandled_exception() { std::terminate(); }
 
     std::coroutine_handle<> continuation_{std::noop_coroutine()};
+    CompletionGroup* group_ = nullptr;
+    std::size_t index_ = 0;
     T result_;
   };
 
@@ -99,6 +126,15 @@ struct AwaitableFunction {
     while (not handle_.done()) handle_.resume();
   }
 
+  // Makes the coroutine a child of group; the caller starts it
+  std::coroutine_handle<> join(CompletionGroup& group, std::size_t index) {
+    handle_.promise().group_ = &group;
+    handle_.promise().index_ = index;
+    return handle_.raw_handle();
+  }
+
+  T take_result() { return std::move(handle_.promise().result_); }
+
  private:
   owning_handle<promise_type> handle_;
 };
@@ -112,11 +148,15 @@ struct AwaitableTask {
     }
 
     std::suspend_always initial_suspend() noexcept { return {}; }
-    ContinuationAwaitable final_suspend() noexcept { return {continuation_}; }
+    ContinuationAwaitable final_suspend() noexcept {
+      return {continuation_, group_, index_};
+    }
     void return_void() {}
     void unhandled_exception() { std::terminate(); }
 
     std::coroutine_handle<> continuation_{std::noop_coroutine()};
+    CompletionGroup* group_ = nullptr;
+    std::size_t index_ = 0;
   };
 
   // Store the coroutine handle
@@ -140,10 +180,291 @@ struct AwaitableTask {
     while (not handle_.done()) handle_.resume();
   }
 
+  std::coroutine_handle<> join(CompletionGroup& group, std::size_t index) {
+    handle_.promise().group_ = &group;
+    handle_.promise().index_ = index;
+    return handle_.raw_handle();
+  }
+
+  std::monostate take_result() { return {}; }
+
  private:
   owning_handle<promise_type> handle_;
 };
 
+// the result of a child in when_all and when_any; std::monostate for a
+// task
+template <typename Child>
+using ResultOf = decltype(std::declval<Child&>().take_result());
+
+// Awaits all children of a vector. The children are started one after the
+// other on the awaiting thread and may finish on any thread. A single
+// counter holds the running children plus one for the start loop, so the
+// parent is resumed exactly once: by symmetric transfer from the last
+// child, or directly when the children are done before the loop ends.
+template <typename Child>
+class WhenAllRange : CompletionGroup {
+ public:
+  explicit WhenAllRange(std::vector<Child> children)
+      : children_(std::move(children)) {}
+
+  bool await_ready() noexcept { return children_.empty(); }
+
+  bool await_suspend(std::coroutine_handle<> parent) noexcept {
+    parent_ = parent;
+    pending_.store(children_.size() + 1, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < children_.size(); ++i) {
+      children_[i].join(*this, i).resume();
+    }
+    return pending_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+  }
+
+  // the results in the order of the children, in one allocation
+  auto await_resume() {
+    if constexpr (std::is_same_v<ResultOf<Child>, std::monostate>) {
+      return;
+    } else {
+      std::vector<ResultOf<Child>> results;
+      results.reserve(children_.size());
+      for (auto& child : children_) results.push_back(child.take_result());
+      return results;
+    }
+  }
+
+ private:
+  std::coroutine_handle<> child_done(std::size_t) noexcept override {
+    return pending_.fetch_sub(1, std::memory_order_acq_rel) == 1
+               ? parent_
+               : std::noop_coroutine();
+  }
+
+  std::vector<Child> children_;
+  std::atomic<std::size_t> pending_{0};
+  std::coroutine_handle<> parent_;
+};
+
+// The same for a fixed set of children of different types; the results
+// come as a tuple and need no allocation
+template <typename... Children>
+class WhenAll : CompletionGroup {
+ public:
+  explicit WhenAll(Children... children) : children_(std::move(children)...) {}
+
+  bool await_ready() noexcept { return sizeof...(Children) == 0; }
+
+  bool await_suspend(std::coroutine_handle<> parent) noexcept {
+    parent_ = parent;
+    pending_.store(sizeof...(Children) + 1, std::memory_order_relaxed);
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+      (std::get<I>(children_).join(*this, I).resume(), ...);
+    }(std::index_sequence_for<Children...>{});
+    return pending_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+  }
+
+  std::tuple<ResultOf<Children>...> await_resume() {
+    return std::apply(
+        [](auto&... child) {
+          return std::tuple<ResultOf<Children>...>{child.take_result()...};
+        },
+        children_);
+  }
+
+ private:
+  std::coroutine_handle<> child_done(std::size_t) noexcept override {
+    return pending_.fetch_sub(1, std::memory_order_acq_rel) == 1
+               ? parent_
+               : std::noop_coroutine();
+  }
+
+  std::tuple<Children...> children_;
+  std::atomic<std::size_t> pending_{0};
+  std::coroutine_handle<> parent_;
+};
+
+// The children are moved out of the range, so it has to be an rvalue
+template <std::ranges::input_range Range>
+  requires(!std::is_lvalue_reference_v<Range>)
+auto when_all(Range&& children) {
+  using Child = std::ranges::range_value_t<Range>;
+  if constexpr (std::is_same_v<std::remove_cvref_t<Range>,
+                               std::vector<Child>>) {
+    return WhenAllRange<Child>{std::move(children)};
+  } else {
+    std::vector<Child> moved;
+    for (auto& child : children) moved.push_back(std::move(child));
+    return WhenAllRange<Child>{std::move(moved)};
+  }
+}
+
+template <typename... Children>
+  requires(!std::ranges::input_range<Children> && ...)
+WhenAll<Children...> when_all(Children... children) {
+  return WhenAll<Children...>{std::move(children)...};
+}
+
+// Resumes the parent with the index and the result of the first child to
+// finish. The others keep running, so the children live in a state on
+// the heap that the last of the awaiter and the children deletes.
+template <typename Child>
+class WhenAny {
+  struct State final : CompletionGroup {
+    explicit State(std::vector<Child> children)
+        : children(std::move(children)), refs(this->children.size() + 1) {}
+
+    std::coroutine_handle<> child_done(std::size_t index) noexcept override {
+      std::coroutine_handle<> resume = std::noop_coroutine();
+      auto none = npos;
+      // the first child and the start loop both have to arrive before the
+      // parent may run
+      if (winner.compare_exchange_strong(none, index,
+                                         std::memory_order_acq_rel) &&
+          arrivals.fetch_add(1, std::memory_order_acq_rel) == 1) {
+        resume = parent;
+      }
+      release();
+      return resume;
+    }
+
+    void release() noexcept {
+      if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    std::vector<Child> children;
+    std::coroutine_handle<> parent;
+    std::atomic<std::size_t> winner{npos};
+    std::atomic<int> arrivals{0};
+    std::atomic<std::size_t> refs;
+  };
+
+ public:
+  // without a child the parent would never be resumed
+  explicit WhenAny(std::vector<Child> children)
+      : state_(children.empty()
+                   ? throw std::invalid_argument("when_any without children")
+                   : new State{std::move(children)}) {}
+
+  WhenAny(WhenAny&& other) noexcept
+      : state_(std::exchange(other.state_, nullptr)),
+        started_(other.started_) {}
+
+  // the children only release their references once they are started
+  ~WhenAny() {
+    if (!state_) return;
+    if (started_) {
+      state_->release();
+    } else {
+      delete state_;
+    }
+  }
+
+  bool await_ready() noexcept { return false; }
+
+  bool await_suspend(std::coroutine_handle<> parent) noexcept {
+    started_ = true;
+    state_->parent = parent;
+    // the awaiter holds a reference, so the state outlives the loop
+    const auto count = state_->children.size();
+    for (std::size_t i = 0; i < count; ++i) {
+      state_->children[i].join(*state_, i).resume();
+    }
+    return state_->arrivals.fetch_add(1, std::memory_order_acq_rel) == 0;
+  }
+
+  std::pair<std::size_t, ResultOf<Child>> await_resume() {
+    const auto index = state_->winner.load(std::memory_order_acquire);
+    return {index, state_->children[index].take_result()};
+  }
+
+ private:
+  State* state_;
+  bool started_ = false;
+};
+
+template <std::ranges::input_range Range>
+  requires(!std::is_lvalue_reference_v<Range>)
+auto when_any(Range&& children) {
+  using Child = std::ranges::range_value_t<Range>;
+  std::vector<Child> moved;
+  for (auto& child : children) moved.push_back(std::move(child));
+  return WhenAny<Child>{std::move(moved)};
+}
+
+// Runs the resumed coroutines on a fixed set of threads
+class ThreadPool {
+ public:
+  explicit ThreadPool(unsigned numberThreads) {
+    for (unsigned i = 0; i < numberThreads; ++i) {
+      workers_.emplace_back([this](std::stop_token token) { run(token); });
+    }
+  }
+
+  ~ThreadPool() {
+    for (auto& worker : workers_) worker.request_stop();
+  }
+
+  // co_await pool.schedule() continues on one of the threads
+  auto schedule() {
+    struct awaiter {
+      ThreadPool& pool;
+      bool await_ready() noexcept { return false; }
+      // a worker may resume the coroutine and free this awaiter before
+      // the notification
+      void await_suspend(std::coroutine_handle<> handle) {
+        auto& target = pool;
+        {
+          std::lock_guard lock(target.mutex_);
+          target.queue_.push_back(handle);
+        }
+        target.condition_.notify_one();
+      }
+      void await_resume() noexcept {}
+    };
+    return awaiter{*this};
+  }
+
+ private:
+  void run(std::stop_token token) {
+    while (true) {
+      std::unique_lock lock(mutex_);
+      if (!condition_.wait(lock, token, [this] { return !queue_.empty(); })) {
+        return;
+      }
+      const auto handle = queue_.front();
+      queue_.pop_front();
+      lock.unlock();
+      handle.resume();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable_any condition_;
+  std::deque<std::coroutine_handle<>> queue_;
+  std::vector<std::jthread> workers_;
+};
+
+// Starts itself and frees its frame at the end
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+// Blocks until task has finished, on whichever thread that happens
+void sync_wait(AwaitableTask& task) {
+  std::binary_semaphore done{0};
+  [](AwaitableTask& task, std::binary_semaphore& done) -> Detached {
+    co_await task;
+    done.release();
+  }(task, done);
+  done.acquire();
+}
+
 AwaitableTask child() { co_return; }
 
 AwaitableTask parent() {
@@ -160,7 +481,107 @@ AwaitableTask other_parent() {
   co_return;
 }
 
+AwaitableFunction<int> square(int value) { co_return value * value; }
+
+// a request that waits for 1 ms on the pool, like a network round trip
+AwaitableFunction<int> request(ThreadPool& pool, int value) {
+  co_await pool.schedule();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  co_return value;
+}
+
+AwaitableTask combine(ThreadPool& pool) {
+  auto [a, b, c] = co_await when_all(square(2), square(3), child());
+  printf("when_all: %d %d\n", a, b);
+
+  std::vector<AwaitableFunction<int>> requests;
+  for (int i = 0; i < 4; ++i) requests.push_back(request(pool, i));
+  int sum = 0;
+  for (auto value : co_await when_all(std::move(requests))) sum += value;
+  printf("when_all on the pool: %d\n", sum);
+
+  std::vector<AwaitableFunction<int>> racing;
+  for (int i = 0; i < 4; ++i) racing.push_back(request(pool, i));
+  auto [index, value] = co_await when_any(std::move(racing));
+  printf("when_any: child %zu returned %d\n", index, value);
+}
+
+template <typename MakeChild>
+AwaitableTask awaitSequential(std::size_t count, MakeChild makeChild,
+                              long long& sum) {
+  for (std::size_t i = 0; i < count; ++i) {
+    sum += co_await makeChild(static_cast<int>(i));
+  }
+}
+
+template <typename MakeChild>
+AwaitableTask awaitAll(std::size_t count, MakeChild makeChild,
+                       long long& sum) {
+  std::vector<AwaitableFunction<int>> children;
+  children.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    children.push_back(makeChild(static_cast<int>(i)));
+  }
+  for (auto value : co_await when_all(std::move(children))) sum += value;
+}
+
+template <typename Func>
+double getSeconds(Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  return dur.count();
+}
+
 int main() {
   parent().run_until_completion();
   other_parent().run_until_completion();
+
+  ThreadPool pool{16};
+  auto combined = combine(pool);
+  sync_wait(combined);
+  printf("\n");
+
+  // children that finish right away: the cost of awaiting
+  for (std::size_t count : {1, 10, 100, 1'000, 10'000}) {
+    const auto rounds = 1'000'000 / count;
+    long long sequentialSum = 0;
+    long long allSum = 0;
+    const auto sequential = getSeconds([&] {
+      for (std::size_t r = 0; r < rounds; ++r) {
+        awaitSequential(count, square, sequentialSum).run_until_completion();
+      }
+    });
+    const auto all = getSeconds([&] {
+      for (std::size_t r = 0; r < rounds; ++r) {
+        awaitAll(count, square, allSum).run_until_completion();
+      }
+    });
+    printf("%5zu children: co_await one by one %.1f ns, when_all %.1f ns "
+           "per child%s\n",
+           count, sequential / (rounds * count) * 1e9,
+           all / (rounds * count) * 1e9,
+           sequentialSum == allSum ? "" : ", different results");
+  }
+  printf("\n");
+
+  // children that wait for 1 ms on a pool of 16 threads
+  auto onPool = [&pool](int value) { return request(pool, value); };
+  for (std::size_t count : {1, 10, 100, 1'000}) {
+    long long sequentialSum = 0;
+    long long allSum = 0;
+    const auto sequential = getSeconds([&] {
+      auto task = awaitSequential(count, onPool, sequentialSum);
+      sync_wait(task);
+    });
+    const auto all = getSeconds([&] {
+      auto task = awaitAll(count, onPool, allSum);
+      sync_wait(task);
+    });
+    printf("%5zu requests of 1 ms: co_await one by one %.3f s, when_all "
+           "%.3f s%s\n",
+           count, sequential, all,
+           sequentialSum == allSum ? "" : ", different results");
+  }
 }
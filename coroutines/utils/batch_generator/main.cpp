@@ -0,0 +1,319 @@
+#include <cassert>
+#include <chrono>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <utility>
+
+// owning_handle from generator_range
+template <typename promise_type>
+struct owning_handle {
+  owning_handle() : handle_() {}
+  owning_handle(std::nullptr_t) : handle_(nullptr) {}
+  owning_handle(std::coroutine_handle<promise_type> handle)
+      : handle_(std::move(handle)) {}
+
+  owning_handle(const owning_handle<promise_type>&) = delete;
+  owning_handle(owning_handle<promise_type>&& other)
+      : handle_(std::exchange(other.handle_, nullptr)) {}
+
+  owning_handle<promise_type>& operator=(const owning_handle<promise_type>&) =
+      delete;
+  owning_handle<promise_type>& operator=(owning_handle<promise_type>&& other) {
+    handle_ = std::exchange(other.handle_, nullptr);
+    return *this;
+  }
+
+  promise_type& promise() const { return handle_.promise(); }
+
+  bool done() const {
+    assert(handle_ != nullptr);
+    return handle_.done();
+  }
+
+  void resume() const {
+    assert(handle_ != nullptr);
+    return handle_.resume();
+  }
+
+  std::coroutine_handle<promise_type> raw_handle() const { return handle_; }
+
+  ~owning_handle() {
+    if (handle_ != nullptr) handle_.destroy();
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// Generator<T> from generator_range, one suspension per element
+template <typename T>
+struct Generator;
+
+template <typename T>
+struct GeneratorPromise {
+  using handle_t = std::coroutine_handle<GeneratorPromise<T>>;
+  Generator<T> get_return_object() {
+    return Generator<T>{handle_t::from_promise(*this)};
+  }
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  std::suspend_always final_suspend() noexcept { return {}; }
+
+  template <std::convertible_to<T> Arg>
+  std::suspend_always yield_value(Arg&& result) {
+    result_ = std::forward<Arg>(result);
+    return {};
+  }
+  void return_void() {}
+  void unhandled_exception() {}
+  T result_;
+};
+
+template <typename T>
+struct Generator {
+  using promise_type = GeneratorPromise<T>;
+
+  explicit Generator(promise_type::handle_t handle) : handle_(handle) {}
+
+  struct iterator {
+    using value_type = T;
+    using difference_type = ptrdiff_t;
+
+    iterator(owning_handle<promise_type> handle) : handle_(std::move(handle)) {}
+    iterator(iterator&& other) noexcept
+        : handle_{std::exchange(other.handle_, {})} {};
+    iterator& operator=(iterator&& other) noexcept {
+      handle_ = std::exchange(other.handle_, {});
+      return *this;
+    }
+
+    T& operator*() const { return handle_.promise().result_; }
+    iterator& operator++() {
+      assert(not handle_.done());
+      handle_.resume();
+      return *this;
+    }
+    void operator++(int) { ++*this; }
+
+    friend bool operator==(const iterator& i, std::default_sentinel_t) {
+      return i.handle_.done();
+    }
+
+   private:
+    owning_handle<promise_type> handle_;
+  };
+
+  iterator begin() {
+    handle_.resume();
+    return iterator{std::move(handle_)};
+  }
+
+  std::default_sentinel_t end() const noexcept { return {}; }
+
+ private:
+  owning_handle<promise_type> handle_;
+};
+
+// co_yield appends to a buffer of Capacity elements and the coroutine only
+// suspends when the buffer is full or the body ends. The consumer still
+// sees one element at a time, but pays for one resume per batch instead of
+// one per element.
+template <std::default_initializable T, std::size_t Capacity = 64>
+struct BatchGenerator {
+  static_assert(Capacity > 0);
+
+  struct promise_type {
+    BatchGenerator get_return_object() {
+      return BatchGenerator{
+          std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    // the last, partial batch is read after the body has ended
+    std::suspend_always final_suspend() noexcept { return {}; }
+
+    // suspends only when the yielded element fills the buffer
+    struct Flush {
+      bool full;
+
+      bool await_ready() const noexcept { return !full; }
+      void await_suspend(std::coroutine_handle<>) const noexcept {}
+      void await_resume() const noexcept {}
+    };
+
+    template <std::convertible_to<T> Arg>
+    Flush yield_value(Arg&& value) {
+      *last++ = std::forward<Arg>(value);
+      return {last == buffer.get() + Capacity};
+    }
+
+    void return_void() {}
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    // Runs the body until it yields at least one element or ends. An
+    // exception of the body is rethrown after the elements yielded
+    // before it.
+    std::span<T> refill() {
+      do {
+        last = buffer.get();
+        if (exception) std::rethrow_exception(exception);
+        if (std::coroutine_handle<promise_type>::from_promise(*this).done()) {
+          break;
+        }
+        std::coroutine_handle<promise_type>::from_promise(*this).resume();
+      } while (last == buffer.get());
+      return {buffer.get(), last};
+    }
+
+    std::unique_ptr<T[]> buffer = std::make_unique<T[]>(Capacity);
+    T* last = buffer.get();  // behind the last yielded element
+    std::exception_ptr exception;
+  };
+
+  struct iterator {
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    T& operator*() const { return *pos; }
+
+    iterator& operator++() {
+      if (++pos == last) refill();
+      return *this;
+    }
+    void operator++(int) { ++*this; }
+
+    // a batch is only empty after the body has ended
+    friend bool operator==(const iterator& i, std::default_sentinel_t) {
+      return i.pos == i.last;
+    }
+
+    void refill() {
+      const auto batch = promise->refill();
+      pos = batch.data();
+      last = batch.data() + batch.size();
+    }
+
+    promise_type* promise;
+    T* pos = nullptr;
+    T* last = nullptr;
+  };
+
+  explicit BatchGenerator(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  // may only be called once
+  iterator begin() {
+    iterator i{&handle_.promise()};
+    i.refill();
+    return i;
+  }
+
+  std::default_sentinel_t end() const noexcept { return {}; }
+
+  // the next batch, for consumers that can handle many elements at once;
+  // empty once the body has ended
+  std::span<const T> next_batch() { return handle_.promise().refill(); }
+
+ private:
+  owning_handle<promise_type> handle_;
+};
+
+// getNext() from concurrency/infiniteDataStream.cpp in the three forms
+Generator<int> getNext(int start = 0, int step = 1) {
+  auto value = start;
+  for (;;) {
+    co_yield value;
+    value += step;
+  }
+}
+
+template <std::size_t Capacity = 64>
+BatchGenerator<int, Capacity> getNextBatched(int start = 0, int step = 1) {
+  auto value = start;
+  for (;;) {
+    co_yield value;
+    value += step;
+  }
+}
+
+template <typename Func>
+void getExecutionTime(const char* title, long long count, Func func) {
+  const auto sta = std::chrono::steady_clock::now();
+  const auto result = func();
+  const std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - sta;
+  printf("%s: %f sec., %.1f million elements/sec. (%lld)\n", title,
+         dur.count(), count / dur.count() / 1e6, result);
+}
+
+int main() {
+  auto coro = [] -> BatchGenerator<int, 2> {
+    co_yield 1;
+    co_yield 2;
+    co_yield 3;
+    co_return;
+  };
+
+  auto empty = [] -> BatchGenerator<int> { co_return; };
+
+  for (auto result : coro()) {
+    printf("result == %d\n", result);
+  }
+
+  for (auto result : empty()) {
+    printf("result == %d\n", result);
+  }
+
+  auto gen = getNextBatched(100, -10);
+  static_assert(std::ranges::input_range<decltype(gen)>);
+  for (auto value : gen | std::views::take(5)) {
+    printf("%d ", value);
+  }
+  printf("\n\n");
+
+  constexpr long long count = 100'000'000;
+  getExecutionTime("Generator<int>", count, [&] {
+    long long sum = 0;
+    for (auto value : getNext() | std::views::take(count)) sum += value;
+    return sum;
+  });
+  getExecutionTime("BatchGenerator<int, 16>", count, [&] {
+    long long sum = 0;
+    for (auto value : getNextBatched<16>() | std::views::take(count)) {
+      sum += value;
+    }
+    return sum;
+  });
+  getExecutionTime("BatchGenerator<int, 64>", count, [&] {
+    long long sum = 0;
+    for (auto value : getNextBatched() | std::views::take(count)) {
+      sum += value;
+    }
+    return sum;
+  });
+  getExecutionTime("BatchGenerator<int, 1024>", count, [&] {
+    long long sum = 0;
+    for (auto value : getNextBatched<1024>() | std::views::take(count)) {
+      sum += value;
+    }
+    return sum;
+  });
+  getExecutionTime("BatchGenerator<int, 1024>::next_batch", count, [&] {
+    long long sum = 0;
+    auto gen = getNextBatched<1024>();
+    for (long long left = count; left > 0;) {
+      const auto batch = gen.next_batch().first(
+          std::min<std::size_t>(1024, static_cast<std::size_t>(left)));
+      for (auto value : batch) sum += value;
+      left -= static_cast<long long>(batch.size());
+    }
+    return sum;
+  });
+}
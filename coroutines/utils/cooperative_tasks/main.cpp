@@ -1,13 +1,74 @@
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <coroutine>
+#include <cstdint>
 #include <cstdio>
+#include <limits>
 #include <list>
 #include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Reads the time stamp counter where there is one, the steady clock
+// elsewhere. It is read on every budget check, so it has to be cheap.
+inline std::uint64_t readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<std::uint64_t>(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Ticks per second, measured once against the steady clock
+inline double ticksPerSecond() {
+  static const double value = [] {
+    const auto sta = std::chrono::steady_clock::now();
+    const auto ticks = readTicks();
+    while (std::chrono::steady_clock::now() - sta <
+           std::chrono::milliseconds(20)) {
+    }
+    const std::chrono::duration<double> dur =
+        std::chrono::steady_clock::now() - sta;
+    return static_cast<double>(readTicks() - ticks) / dur.count();
+  }();
+  return value;
+}
+
+// Time a task has run in the scheduler, in ticks, and how many times it
+// was resumed. A task can also bring its own slice budget, in time and in
+// maybe_yield() calls; zero takes the budget of the scheduler.
+struct TaskStats {
+  std::chrono::nanoseconds budget{0};
+  std::uint64_t iterations = 0;
+
+  std::uint64_t ticks = 0;
+  std::uint64_t slices = 0;
+
+  double seconds() const {
+    return static_cast<double>(ticks) / ticksPerSecond();
+  }
+};
 
 struct Scheduler {
-  // Add a coroutine under the control of the scheduler
-  void enqueue(std::coroutine_handle<> handle) const {
-    coroutines_.push_back(handle);
+  // Add a coroutine under the control of the scheduler; its running time
+  // goes to stats
+  void enqueue(std::coroutine_handle<> handle,
+               TaskStats* stats = nullptr) const {
+    coroutines_.push_back({handle, stats});
+  }
+
+  // Every resumed coroutine gets a slice of budget, unless its TaskStats
+  // bring their own; maybe_yield() suspends it once the time or the
+  // number of calls is used up. Zero means no budget.
+  void set_budget(std::chrono::nanoseconds budget,
+                  std::uint64_t iterations = 0) const {
+    budget_ = toTicks(budget);
+    iterations_ = iterations;
   }
 
   void run() const {
@@ -17,10 +78,28 @@ struct Scheduler {
       auto active = coroutines_.front();
       coroutines_.pop_front();
 
-      active.resume();
+      auto budget = budget_;
+      auto iterations = iterations_;
+      if (active.stats) {
+        if (active.stats->budget.count()) {
+          budget = toTicks(active.stats->budget);
+        }
+        if (active.stats->iterations) iterations = active.stats->iterations;
+      }
+      const auto start = readTicks();
+      deadline_ = budget ? start + budget
+                         : std::numeric_limits<std::uint64_t>::max();
+      callsLeft_ =
+          iterations ? iterations : std::numeric_limits<std::uint64_t>::max();
+      current_ = active.stats;
+      active.handle.resume();
+      if (active.stats) {
+        active.stats->ticks += readTicks() - start;
+        ++active.stats->slices;
+      }
       // The coroutine is owned by the scheduler,
       // meaning it is responsible for destroying it
-      if (active.done()) active.destroy();
+      if (active.handle.done()) active.handle.destroy();
     }
   }
 
@@ -34,7 +113,7 @@ struct Scheduler {
     void await_suspend(std::coroutine_handle<> ctx) {
       // Re-schedule the suspended coroutine
       // ctx is a handle to the suspended coroutine
-      Scheduler{}.enqueue(ctx);
+      Scheduler{}.enqueue(ctx, current_);
     }
     // Called as the last part of evaluating co_await,
     // the coroutine is resumed just before this call
@@ -44,12 +123,41 @@ struct Scheduler {
 
   WakeupAwaitable wake_up() const { return WakeupAwaitable{}; }
 
+  // A preemption point for long-running coroutines: only suspends when the
+  // slice is used up, otherwise the check is a decrement and one counter
+  // read
+  struct YieldAwaitable : WakeupAwaitable {
+    bool await_ready() { return --callsLeft_ != 0 && readTicks() < deadline_; }
+  };
+
+  YieldAwaitable maybe_yield() const { return YieldAwaitable{}; }
+
  private:
+  struct scheduled_coroutine {
+    std::coroutine_handle<> handle;
+    TaskStats* stats;
+  };
+
+  static std::uint64_t toTicks(std::chrono::nanoseconds budget) {
+    return static_cast<std::uint64_t>(
+        static_cast<double>(budget.count()) * ticksPerSecond() / 1e9);
+  }
+
   // Monostate
-  static std::list<std::coroutine_handle<>> coroutines_;
+  static std::list<scheduled_coroutine> coroutines_;
+  static std::uint64_t budget_;
+  static std::uint64_t iterations_;
+  static std::uint64_t deadline_;
+  static std::uint64_t callsLeft_;
+  static TaskStats* current_;
 };
 
-std::list<std::coroutine_handle<>> Scheduler::coroutines_{};
+std::list<Scheduler::scheduled_coroutine> Scheduler::coroutines_{};
+std::uint64_t Scheduler::budget_ = 0;
+std::uint64_t Scheduler::iterations_ = 0;
+std::uint64_t Scheduler::deadline_ = 0;
+std::uint64_t Scheduler::callsLeft_ = 0;
+TaskStats* Scheduler::current_ = nullptr;
 
 template <typename promise_type>
 struct owning_handle {
@@ -102,9 +210,9 @@ struct Task {
     void unhandled_exception() {}
   };
 
-  void detach() {
+  void detach(TaskStats* stats = nullptr) {
     // Give control of this coroutine to the scheduler
-    Scheduler{}.enqueue(handle_.detach());
+    Scheduler{}.enqueue(handle_.detach(), stats);
   }
 
   // Store the coroutine handle
@@ -114,6 +222,67 @@ struct Task {
   owning_handle<promise_type> handle_;
 };
 
+// One unit of CPU work, about a microsecond
+std::uint64_t workSink = 0;
+
+void workUnit() {
+  auto value = workSink;
+  for (int i = 0; i < 900; ++i) value = value * 6364136223846793005 + 1;
+  workSink = value;
+}
+
+// A task of units of work with a preemption point after each unit;
+// records when it finished
+Task worker(int units, std::chrono::steady_clock::time_point& finished) {
+  for (int i = 0; i < units; ++i) {
+    workUnit();
+    co_await Scheduler{}.maybe_yield();
+  }
+  finished = std::chrono::steady_clock::now();
+}
+
+// 1000 short tasks of 10 units and 4 long ones of 20000 units, spawned
+// together with a long one in front of every 250 short ones; the long
+// ones start with longTask as their stats
+void benchmark(const char* title, std::chrono::nanoseconds budget,
+               TaskStats longTask = {}) {
+  constexpr int numberShort = 1'000;
+  constexpr int numberLong = 4;
+  Scheduler{}.set_budget(budget);
+
+  std::vector<std::chrono::steady_clock::time_point> finished(numberShort +
+                                                              numberLong);
+  std::vector<TaskStats> stats(numberShort + numberLong);
+  std::fill(stats.begin() + numberShort, stats.end(), longTask);
+  const auto sta = std::chrono::steady_clock::now();
+  for (int i = 0, next = 0; i < numberShort; ++i) {
+    if (i % (numberShort / numberLong) == 0) {
+      worker(20'000, finished[numberShort + next])
+          .detach(&stats[numberShort + next]);
+      ++next;
+    }
+    worker(10, finished[i]).detach(&stats[i]);
+  }
+  Scheduler{}.run();
+
+  std::vector<double> latencies;
+  for (int i = 0; i < numberShort; ++i) {
+    const std::chrono::duration<double, std::milli> latency =
+        finished[i] - sta;
+    latencies.push_back(latency.count());
+  }
+  std::ranges::sort(latencies);
+  const std::chrono::duration<double, std::milli> total =
+      std::chrono::steady_clock::now() - sta;
+  printf("%s: short tasks p50 %.2f ms, p99 %.2f ms; all %.1f ms\n", title,
+         latencies[numberShort / 2], latencies[numberShort * 99 / 100],
+         total.count());
+  const auto& longStats = stats[numberShort];
+  printf("  first long task: %.1f ms CPU in %llu slices\n",
+         longStats.seconds() * 1e3,
+         static_cast<unsigned long long>(longStats.slices));
+}
+
 int main() {
   auto coro = [] -> Task {
     puts("stage one");
@@ -128,4 +297,22 @@ int main() {
   coro().detach();
 
   Scheduler{}.run();
+
+  // the cost of a preemption point that does not suspend
+  constexpr int checks = 10'000'000;
+  auto checking = [](int count) -> Task {
+    for (int i = 0; i < count; ++i) co_await Scheduler{}.maybe_yield();
+  };
+  TaskStats checkStats;
+  checking(checks).detach(&checkStats);
+  Scheduler{}.run();
+  printf("\nmaybe_yield() without suspending: %.1f ns\n",
+         checkStats.seconds() / checks * 1e9);
+
+  benchmark("no budget", std::chrono::nanoseconds{0});
+  benchmark("budget 100 us", std::chrono::microseconds{100});
+  benchmark("long tasks 20 us", std::chrono::nanoseconds{0},
+            {.budget = std::chrono::microseconds{20}});
+  benchmark("long tasks 20 iterations", std::chrono::nanoseconds{0},
+            {.iterations = 20});
 }
@@ -2,28 +2,41 @@
 #include <chrono>
 #include <coroutine>
 #include <cstdio>
+#include <ctime>
 #include <format>
 #include <list>
 #include <queue>
+#include <stop_token>
 #include <thread>
 #include <utility>
+#include <vector>
 
 struct Scheduler {
   using time_point = std::chrono::time_point<std::chrono::system_clock>;
 
-  // Add a coroutine under the control of the scheduler
+  // Add a coroutine under the control of the scheduler; once a stop is
+  // requested on token, it is destroyed instead of resumed
   void enqueue(std::coroutine_handle<> handle,
-               time_point time = std::chrono::system_clock::now()) const {
-    pending_coroutines_.push(std::make_pair(time, handle));
+               time_point time = std::chrono::system_clock::now(),
+               std::stop_token token = {}) const {
+    pending_coroutines_.push({time, handle, std::move(token)});
   }
 
   void run() const {
     while (not pending_coroutines_.empty()) {
-      if (pending_coroutines_.top().first > std::chrono::system_clock::now()) {
-        std::this_thread::sleep_until(pending_coroutines_.top().first);
+      // a cancelled coroutine is dropped without waiting for its time
+      if (pending_coroutines_.top().token.stop_requested()) {
+        auto cancelled = pending_coroutines_.top().handle;
+        pending_coroutines_.pop();
+        cancelled.destroy();
+        continue;
       }
 
-      auto active = pending_coroutines_.top().second;
+      if (pending_coroutines_.top().time > std::chrono::system_clock::now()) {
+        std::this_thread::sleep_until(pending_coroutines_.top().time);
+      }
+
+      auto active = pending_coroutines_.top().handle;
       pending_coroutines_.pop();
 
       active.resume();
@@ -41,7 +54,7 @@ struct Scheduler {
     // control to the caller.
     void await_suspend(std::coroutine_handle<> ctx) {
       // The argument is a handle to the suspended coroutine.
-      Scheduler{}.enqueue(ctx, time_);
+      Scheduler{}.enqueue(ctx, time_, std::move(token_));
     }
     // Called as the last part of evaluating co_await,
     // the coroutine is resumed just before this call
@@ -49,18 +62,29 @@ struct Scheduler {
     void await_resume() {}
 
     time_point time_;
+    std::stop_token token_;
   };
 
   WakeupAwaitable wake_up() const {
-    return WakeupAwaitable{std::chrono::system_clock::now()};
+    return WakeupAwaitable{std::chrono::system_clock::now(), {}};
   }
-  WakeupAwaitable wake_up(time_point time) const {
-    return WakeupAwaitable{time};
+  WakeupAwaitable wake_up(time_point time, std::stop_token token = {}) const {
+    return WakeupAwaitable{time, std::move(token)};
   }
 
  private:
+  struct timed_coroutine {
+    time_point time;
+    std::coroutine_handle<> handle;
+    std::stop_token token;
+
+    friend bool operator>(const timed_coroutine& lhs,
+                          const timed_coroutine& rhs) {
+      return lhs.time > rhs.time;
+    }
+  };
+
   // Monostate
-  using timed_coroutine = std::pair<time_point, std::coroutine_handle<>>;
   static std::priority_queue<timed_coroutine, std::vector<timed_coroutine>,
                              std::greater<>>
       pending_coroutines_;
@@ -121,13 +145,18 @@ struct Task {
     void unhandled_exception() {}
     auto await_transform(
         std::chrono::time_point<std::chrono::system_clock> time) const {
-      return Scheduler{}.wake_up(time);
+      return Scheduler{}.wake_up(time, stop_token_);
     }
+
+    std::stop_token stop_token_;
   };
 
-  void detach() {
-    // Give control of this coroutine to the scheduler
-    Scheduler{}.enqueue(handle_.detach());
+  // Give control of this coroutine to the scheduler; a stop request on
+  // token cancels it at its next co_await
+  void detach(std::stop_token token = {}) {
+    handle_.promise().stop_token_ = token;
+    Scheduler{}.enqueue(handle_.detach(), std::chrono::system_clock::now(),
+                        std::move(token));
   }
 
   // Store the coroutine handle
@@ -137,6 +166,51 @@ struct Task {
   owning_handle<promise_type> handle_;
 };
 
+// A request of 20 steps of 50 us of work, with a co_await between the
+// steps; counts the steps it runs after it has been cancelled
+constexpr int requestSteps = 20;
+constexpr auto stepTime = std::chrono::microseconds(50);
+
+Task request(std::stop_token cancelled, long& wastedSteps) {
+  for (int step = 0; step < requestSteps; ++step) {
+    const auto end = std::chrono::steady_clock::now() + stepTime;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+    if (cancelled.stop_requested()) ++wastedSteps;
+    co_await std::chrono::system_clock::now();
+  }
+}
+
+// Cancels 9 of 10 requests when they are about half done
+Task cancelAt(std::chrono::system_clock::time_point time,
+              std::vector<std::stop_source>& sources) {
+  co_await time;
+  for (std::size_t i = 0; i < sources.size(); ++i) {
+    if (i % 10 != 0) sources[i].request_stop();
+  }
+}
+
+void benchmark(const char* title, bool passTokens) {
+  constexpr std::size_t numberRequests = 1'000;
+  std::vector<std::stop_source> sources(numberRequests);
+  long wastedSteps = 0;
+  const auto halfDone = numberRequests * requestSteps * stepTime / 2;
+
+  const auto cpuStart = std::clock();
+  for (auto& source : sources) {
+    request(source.get_token(), wastedSteps)
+        .detach(passTokens ? source.get_token() : std::stop_token{});
+  }
+  cancelAt(std::chrono::system_clock::now() + halfDone, sources).detach();
+  Scheduler{}.run();
+  const auto cpu = static_cast<double>(std::clock() - cpuStart) /
+                   CLOCKS_PER_SEC;
+
+  std::puts(std::format("{}: {:.3f} sec. CPU, {} steps after cancel",
+                        title, cpu, wastedSteps)
+                .c_str());
+}
+
 int main() {
   using namespace std::chrono;
   auto coro = [] -> Task {
@@ -153,4 +227,20 @@ int main() {
   coro().detach();
 
   Scheduler{}.run();
+
+  // the second one is cancelled before its second step
+  std::stop_source source;
+  coro().detach();
+  coro().detach(source.get_token());
+  [](std::stop_source& source) -> Task {
+    co_await (system_clock::now() + 300ms);
+    source.request_stop();
+  }(source).detach();
+
+  Scheduler{}.run();
+
+  std::puts("");
+  std::puts("1000 requests, 90% cancelled half way:");
+  benchmark("  stop tokens ignored", false);
+  benchmark("  stop tokens passed to the scheduler", true);
 }